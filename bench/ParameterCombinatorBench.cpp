@@ -0,0 +1,584 @@
+#include "ParameterCombinator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#else
+#include <malloc.h>
+#endif
+
+using namespace parameterCombinator;
+
+// Allocation tracking. Every allocation of the process goes through these operators, so the counters
+// include the library as well as the benchmark itself.
+
+namespace
+{
+	std::atomic<std::size_t> allocationCount{ 0 };
+	std::atomic<std::size_t> allocatedBytes{ 0 };
+	std::atomic<std::size_t> liveBytes{ 0 };
+	std::atomic<std::size_t> peakLiveBytes{ 0 };
+
+	// Room in front of each block to remember its size, keeping the default new alignment
+	constexpr std::size_t allocationHeader = alignof(std::max_align_t);
+
+	void* trackedAllocate(std::size_t size)
+	{
+		void* block = std::malloc(size + allocationHeader);
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		*static_cast<std::size_t*>(block) = size;
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		std::size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		std::size_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+		while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+		return static_cast<char*>(block) + allocationHeader;
+	}
+
+	void trackedDeallocate(void* ptr)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+		void* block = static_cast<char*>(ptr) - allocationHeader;
+		liveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+		std::free(block);
+	}
+
+	// std::pmr::new_delete_resource() allocates through the aligned operators. The header grows to the alignment
+	// and the size is kept right in front of the returned pointer.
+	std::size_t alignedHeader(std::align_val_t alignment)
+	{
+		return std::max(static_cast<std::size_t>(alignment), allocationHeader);
+	}
+
+	void* trackedAllocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		std::size_t align = static_cast<std::size_t>(alignment);
+		std::size_t header = alignedHeader(alignment);
+		std::size_t total = (size + header + align - 1) / align * align;
+#ifdef _WIN32
+		void* block = _aligned_malloc(total, align);
+#else
+		void* block = std::aligned_alloc(align, total);
+#endif
+		if (!block)
+		{
+			throw std::bad_alloc();
+		}
+		char* ptr = static_cast<char*>(block) + header;
+		*reinterpret_cast<std::size_t*>(ptr - sizeof(std::size_t)) = size;
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		std::size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		std::size_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+		while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+		return ptr;
+	}
+
+	void trackedDeallocateAligned(void* ptr, std::align_val_t alignment)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+		char* bytes = static_cast<char*>(ptr);
+		liveBytes.fetch_sub(*reinterpret_cast<std::size_t*>(bytes - sizeof(std::size_t)), std::memory_order_relaxed);
+#ifdef _WIN32
+		_aligned_free(bytes - alignedHeader(alignment));
+#else
+		std::free(bytes - alignedHeader(alignment));
+#endif
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return trackedAllocate(size);
+}
+void* operator new[](std::size_t size)
+{
+	return trackedAllocate(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return trackedAllocate(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return trackedAllocate(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+void operator delete(void* ptr) noexcept
+{
+	trackedDeallocate(ptr);
+}
+void operator delete[](void* ptr) noexcept
+{
+	trackedDeallocate(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	trackedDeallocate(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	trackedDeallocate(ptr);
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return trackedAllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return trackedAllocateAligned(size, alignment);
+}
+void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+	trackedDeallocateAligned(ptr, alignment);
+}
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+	trackedDeallocateAligned(ptr, alignment);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	trackedDeallocateAligned(ptr, alignment);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	trackedDeallocateAligned(ptr, alignment);
+}
+
+// Synthetic parameter spaces
+
+enum class ValueType { Int, Double, String };
+
+struct BenchSpace
+{
+	std::string typeMix;
+	std::size_t dimensions;
+	std::size_t valuesPerDimension;
+	double dontCareDensity;
+	std::vector<ValueType> types;
+	parameterCombinations_t paramCombs;
+	dontCares_t dontCares;
+};
+
+std::string parameterName(std::size_t dimension)
+{
+	return "param-" + std::to_string(dimension);
+}
+
+Parameter makeValue(ValueType type, std::size_t idx)
+{
+	switch (type)
+	{
+	case ValueType::Int:
+		return Parameter(static_cast<int>(idx));
+	case ValueType::Double:
+		return Parameter(0.5 * static_cast<double>(idx));
+	default:
+		return Parameter(std::string("value-") + std::to_string(idx));
+	}
+}
+
+// Each (parameter, value) gets a don't care rule with probability 'dontCareDensity'. A rule disables the next parameter.
+BenchSpace makeSpace(const std::string& typeMix, std::size_t dimensions, std::size_t valuesPerDimension, double dontCareDensity)
+{
+	BenchSpace space{ typeMix, dimensions, valuesPerDimension, dontCareDensity, {}, {}, {} };
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	for (std::size_t dimension = 0; dimension < dimensions; ++dimension)
+	{
+		ValueType type = ValueType::Int;
+		if (typeMix == "double")
+		{
+			type = ValueType::Double;
+		}
+		else if (typeMix == "string")
+		{
+			type = ValueType::String;
+		}
+		else if (typeMix == "mixed")
+		{
+			type = static_cast<ValueType>(dimension % 3);
+		}
+		space.types.push_back(type);
+
+		ParametersVec values;
+		for (std::size_t idx = 0; idx < valuesPerDimension; ++idx)
+		{
+			Parameter value = makeValue(type, idx);
+			values.push_back(value);
+			if (dimension + 1 < dimensions && uniform(rng) < dontCareDensity)
+			{
+				space.dontCares[parameterName(dimension)][value].insert(parameterName(dimension + 1));
+			}
+		}
+		space.paramCombs[parameterName(dimension)] = values;
+	}
+	return space;
+}
+
+// Measurement and reporting
+
+struct Measurement
+{
+	std::chrono::steady_clock::time_point start;
+	std::size_t allocations;
+	std::size_t bytes;
+	// Heap already in use, e.g. by the parameter space, which the peak of the measured operation does not include
+	std::size_t startLiveBytes;
+};
+
+Measurement startMeasurement()
+{
+	std::size_t live = liveBytes.load();
+	peakLiveBytes.store(live);
+	return { std::chrono::steady_clock::now(), allocationCount.load(), allocatedBytes.load(), live };
+}
+
+// High-water mark of the whole process so far, not of a single benchmark. It never decreases, so benchmarks are
+// compared by peakHeapBytes instead.
+long processPeakRssKb()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+#else
+	return -1;
+#endif
+}
+
+// One JSON object per line so results can be collected and diffed by scripts
+void report(const std::string& benchmark, const BenchSpace& space, std::size_t items, const Measurement& measurement)
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - measurement.start).count();
+	std::size_t allocations = allocationCount.load() - measurement.allocations;
+	std::size_t bytes = allocatedBytes.load() - measurement.bytes;
+	std::cout << "{\"benchmark\":\"" << benchmark << "\""
+		<< ",\"types\":\"" << space.typeMix << "\""
+		<< ",\"dimensions\":" << space.dimensions
+		<< ",\"valuesPerDimension\":" << space.valuesPerDimension
+		<< ",\"dontCareDensity\":" << space.dontCareDensity
+		<< ",\"items\":" << items
+		<< ",\"seconds\":" << seconds
+		<< ",\"itemsPerSecond\":" << (seconds > 0.0 ? static_cast<double>(items) / seconds : 0.0)
+		<< ",\"allocations\":" << allocations
+		<< ",\"allocatedBytes\":" << bytes
+		<< ",\"peakHeapBytes\":" << peakLiveBytes.load() - measurement.startLiveBytes
+		<< ",\"processPeakRssKb\":" << processPeakRssKb()
+		<< "}" << std::endl;
+}
+
+std::size_t rawProductSize(const BenchSpace& space)
+{
+	std::size_t size = 1;
+	for (std::size_t dimension = 0; dimension < space.dimensions; ++dimension)
+	{
+		size *= space.valuesPerDimension;
+	}
+	return size;
+}
+
+// Benchmarks
+
+void benchCombine(BenchSpace& space)
+{
+	Measurement measurement = startMeasurement();
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	report("combine", space, rawProductSize(space), measurement);
+}
+
+void benchCombineArena(BenchSpace& space)
+{
+	Measurement measurement = startMeasurement();
+	ParameterCombinator paramCombinator(StorageMode::Arena);
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	report("combineArena", space, rawProductSize(space), measurement);
+}
+
+void benchClearCombinations(BenchSpace& space, StorageMode storageMode, const std::string& benchmark)
+{
+	ParameterCombinator paramCombinator(storageMode);
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	std::size_t items = paramCombinator.getParameterInstanceSet()->size();
+
+	Measurement measurement = startMeasurement();
+	paramCombinator.clearCombinations();
+	report(benchmark, space, items, measurement);
+}
+
+void benchClearCombinationsHeap(BenchSpace& space)
+{
+	benchClearCombinations(space, StorageMode::Heap, "clearCombinations");
+}
+
+void benchClearCombinationsArena(BenchSpace& space)
+{
+	benchClearCombinations(space, StorageMode::Arena, "clearCombinationsArena");
+}
+
+void benchExtract(BenchSpace& space, StorageMode storageMode, const std::string& benchmark)
+{
+	ParameterCombinator paramCombinator(storageMode);
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	std::size_t items = paramCombinator.getParameterInstanceSet()->size();
+
+	// Moving the set out allocates only the empty set left behind. Arena results are copied onto the heap.
+	Measurement measurement = startMeasurement();
+	parameterInstanceSet_t paramSet = paramCombinator.extract();
+	report(benchmark, space, items, measurement);
+	if (paramSet.size() != items)
+	{
+		std::cerr << "extract lost combinations" << std::endl;
+	}
+}
+
+void benchExtractHeap(BenchSpace& space)
+{
+	benchExtract(space, StorageMode::Heap, "extract");
+}
+
+void benchExtractArena(BenchSpace& space)
+{
+	benchExtract(space, StorageMode::Arena, "extractArena");
+}
+
+void benchAddCombinations(BenchSpace& space)
+{
+	// Split the first parameter's values between two combinators and merge them back
+	BenchSpace half1 = space, half2 = space;
+	ParametersVec values1, values2;
+	const ParametersVec& values = space.paramCombs[parameterName(0)];
+	for (std::size_t idx = 0; idx < values.size(); ++idx)
+	{
+		(idx % 2 ? values2 : values1).push_back(values[idx]);
+	}
+	half1.paramCombs[parameterName(0)] = values1;
+	half2.paramCombs[parameterName(0)] = values2;
+
+	ParameterCombinator paramCombinator1, paramCombinator2, sum;
+	paramCombinator1.combine(half1.paramCombs, half1.dontCares);
+	paramCombinator2.combine(half2.paramCombs, half2.dontCares);
+	std::size_t items = paramCombinator1.getParameterInstanceSet()->size() + paramCombinator2.getParameterInstanceSet()->size();
+
+	Measurement measurement = startMeasurement();
+	sum.addCombinations(paramCombinator1, paramCombinator2, space.dontCares);
+	report("addCombinations", space, items, measurement);
+}
+
+void benchSetInsertion(BenchSpace& space)
+{
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	std::vector<parameterInstanceMap_t> instances(paramCombinator.getParameterInstanceSet()->rbegin(),
+		paramCombinator.getParameterInstanceSet()->rend());
+
+	Measurement measurement = startMeasurement();
+	parameterInstanceSet_t paramSet(ParameterInstanceSetCompare{ space.dontCares });
+	for (auto& paramInstance : instances)
+	{
+		paramSet.insert(paramInstance);
+	}
+	report("setInsertion", space, instances.size(), measurement);
+}
+
+void benchGetVal(BenchSpace& space)
+{
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+
+	Measurement measurement = startMeasurement();
+	std::size_t items = 0;
+	double checksum = 0.0;
+	for (auto& paramInstance : *paramSet)
+	{
+		for (std::size_t dimension = 0; dimension < space.dimensions; ++dimension)
+		{
+			const std::string name = parameterName(dimension);
+			if (!paramInstance.count(name))
+			{
+				continue;
+			}
+			++items;
+			switch (space.types[dimension])
+			{
+			case ValueType::Int:
+				checksum += getVal<int>(paramInstance, name);
+				break;
+			case ValueType::Double:
+				checksum += getVal<double>(paramInstance, name);
+				break;
+			default:
+				checksum += static_cast<double>(getVal<std::string>(paramInstance, name).size());
+				break;
+			}
+		}
+	}
+	report("getVal", space, items, measurement);
+	if (checksum < 0.0)
+	{
+		std::cerr << checksum << std::endl;
+	}
+}
+
+void benchGenerateCombinationName(BenchSpace& space)
+{
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+
+	Measurement measurement = startMeasurement();
+	std::size_t totalLength = 0;
+	for (auto& paramInstance : *paramSet)
+	{
+		totalLength += ParameterCombinator::generateCombinationName(paramInstance).size();
+	}
+	report("generateCombinationName", space, paramSet->size(), measurement);
+	if (!totalLength && !paramSet->empty())
+	{
+		std::cerr << "Empty combination names" << std::endl;
+	}
+}
+
+void benchBitmapIndex(BenchSpace& space)
+{
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(space.paramCombs, space.dontCares);
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+
+	Measurement measurement = startMeasurement();
+	ParameterIndex index(*paramSet);
+	report("buildIndex", space, paramSet->size(), measurement);
+
+	// (param-0 == first value and param-1 != first value) or param-1 absent
+	measurement = startMeasurement();
+	RoaringBitmap rows = index.equals(parameterName(0), makeValue(space.types[0], 0));
+	if (space.dimensions > 1)
+	{
+		std::string name = parameterName(1);
+		rows &= index.notEquals(name, makeValue(space.types[1], 0));
+		rows |= index.absent(name);
+	}
+	std::size_t matches = index.instances(rows).size();
+	report("indexQuery", space, paramSet->size(), measurement);
+	if (matches > paramSet->size())
+	{
+		std::cerr << "Index query matched more rows than exist" << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = false;
+	bool large = false;
+	std::string filter;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+		if (option == "--quick")
+		{
+			quick = true;
+		}
+		else if (option == "--large")
+		{
+			large = true;
+		}
+		else if (option == "--filter" && arg + 1 < argc)
+		{
+			filter = argv[++arg];
+		}
+		else
+		{
+			std::cerr << "Usage: ParameterCombinatorBench [--quick | --large] [--filter <benchmark name substring>]" << std::endl;
+			return 1;
+		}
+	}
+
+	struct Shape
+	{
+		std::size_t dimensions;
+		std::size_t valuesPerDimension;
+	};
+	std::vector<Shape> shapes = { { 3, 10 }, { 6, 3 }, { 10, 2 } };
+	if (quick)
+	{
+		shapes = { { 3, 4 }, { 5, 3 } };
+	}
+	else if (large)
+	{
+		shapes = { { 3, 40 }, { 5, 10 }, { 8, 4 }, { 16, 2 } };
+	}
+	const std::vector<std::string> typeMixes = { "int", "double", "string", "mixed" };
+	const std::vector<double> dontCareDensities = { 0.0, 0.25, 0.5 };
+
+	const std::vector<std::pair<std::string, void(*)(BenchSpace&)>> benchmarks =
+	{
+		{ "combine",                 benchCombine },
+		{ "combineArena",            benchCombineArena },
+		{ "clearCombinations",       benchClearCombinationsHeap },
+		{ "clearCombinationsArena",  benchClearCombinationsArena },
+		{ "addCombinations",         benchAddCombinations },
+		{ "extract",                 benchExtractHeap },
+		{ "extractArena",            benchExtractArena },
+		{ "setInsertion",            benchSetInsertion },
+		{ "getVal",                  benchGetVal },
+		{ "generateCombinationName", benchGenerateCombinationName },
+		{ "bitmapIndex",             benchBitmapIndex },
+	};
+
+	for (auto& [name, benchmark] : benchmarks)
+	{
+		if (!filter.empty() && name.find(filter) == std::string::npos)
+		{
+			continue;
+		}
+		for (auto& shape : shapes)
+		{
+			for (auto& typeMix : typeMixes)
+			{
+				for (double dontCareDensity : dontCareDensities)
+				{
+					BenchSpace space = makeSpace(typeMix, shape.dimensions, shape.valuesPerDimension, dontCareDensity);
+					benchmark(space);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace parameterCombinator
+{
+	// Bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's ring of sequenced cells).
+	// tryPush fails when the queue is full and tryPop when it is empty; callers decide how to wait.
+	template<typename T>
+	class BoundedQueue
+	{
+	public:
+		// The capacity is rounded up to a power of two
+		explicit BoundedQueue(std::size_t capacity)
+		{
+			std::size_t size = 2;
+			while (size < capacity)
+			{
+				size *= 2;
+			}
+			mask_ = size - 1;
+			cells_ = std::make_unique<Cell[]>(size);
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				cells_[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		std::size_t capacity() const
+		{
+			return mask_ + 1;
+		}
+
+		bool tryPush(const T& value)
+		{
+			std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &cells_[pos & mask_];
+				std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+				if (diff == 0)
+				{
+					if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = enqueuePos_.load(std::memory_order_relaxed);
+				}
+			}
+			cell->value = value;
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool tryPop(T& value)
+		{
+			std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+			Cell* cell;
+			while (true)
+			{
+				cell = &cells_[pos & mask_];
+				std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+				if (diff == 0)
+				{
+					if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = dequeuePos_.load(std::memory_order_relaxed);
+				}
+			}
+			value = cell->value;
+			cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> cells_;
+		std::size_t mask_;
+		// Producers and consumers update different cache lines
+		alignas(64) std::atomic<std::size_t> enqueuePos_{ 0 };
+		alignas(64) std::atomic<std::size_t> dequeuePos_{ 0 };
+	};
+
+} // Namespace parameterCombinator
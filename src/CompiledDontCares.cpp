@@ -0,0 +1,238 @@
+#include "CompiledDontCares.h"
+#include <algorithm>
+
+namespace parameterCombinator
+{
+	ParameterMask::ParameterMask(std::size_t words)
+		: words_(words), inline_{}
+	{
+		if (words_ > inlineWords)
+		{
+			heap_.assign(words_, 0);
+		}
+	}
+
+	std::uint64_t* ParameterMask::data()
+	{
+		return heap_.empty() ? inline_.data() : heap_.data();
+	}
+
+	const std::uint64_t* ParameterMask::data() const
+	{
+		return heap_.empty() ? inline_.data() : heap_.data();
+	}
+
+	std::size_t ParameterMask::words() const
+	{
+		return words_;
+	}
+
+	bool ParameterMask::test(std::size_t bit) const
+	{
+		return (data()[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	void ParameterMask::set(std::size_t bit)
+	{
+		data()[bit / 64] |= std::uint64_t(1) << (bit % 64);
+	}
+
+	CompiledDontCares::CompiledDontCares(const dontCares_t& dontCares)
+	{
+		for (auto& [key, values] : dontCares)
+		{
+			names_.push_back(key);
+			for (auto& value : values)
+			{
+				names_.insert(names_.end(), value.second.begin(), value.second.end());
+			}
+		}
+		std::sort(names_.begin(), names_.end());
+		names_.erase(std::unique(names_.begin(), names_.end()), names_.end());
+		compile(dontCares);
+	}
+
+	CompiledDontCares::CompiledDontCares(const dontCares_t& dontCares, const parameterCombinations_t& paramCombs)
+	{
+		std::vector<const ParametersVec*> sequences;
+		for (auto& param : paramCombs)
+		{
+			names_.push_back(param.first);
+			sequences.push_back(&param.second);
+		}
+		compile(dontCares);
+
+		// Resolve every value of the rule parameters once so generation only deals with indices
+		for (auto& rule : rules_)
+		{
+			const ParametersVec& values = *sequences[rule.key];
+			rule.maskByValueIndex.assign(values.size(), rule.totalMask);
+			if (rule.totalMask != noRule)
+			{
+				continue;
+			}
+			for (std::size_t idx = 0; idx < values.size(); ++idx)
+			{
+				rule.maskByValueIndex[idx] = findMask(rule, values[idx]);
+			}
+		}
+	}
+
+	void CompiledDontCares::compile(const dontCares_t& dontCares)
+	{
+		words_ = std::max<std::size_t>(1, (names_.size() + 63) / 64);
+		for (auto& [key, values] : dontCares)
+		{
+			// Rules on parameters that are not indexed can never fire
+			std::size_t keyBit = bit(key);
+			if (keyBit == names_.size())
+			{
+				continue;
+			}
+			Rule rule;
+			rule.key = keyBit;
+			if (values.empty())
+			{
+				rule.totalMask = addMask({ key }, key);
+			}
+			for (auto& [value, disabledNames] : values)
+			{
+				rule.values.emplace_back(value, addMask(disabledNames, key + "=" + value->toString()));
+			}
+			std::sort(rule.values.begin(), rule.values.end(),
+				[](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+			rules_.push_back(std::move(rule));
+		}
+	}
+
+	std::uint32_t CompiledDontCares::addMask(const std::set<std::string>& disabledNames, std::string label)
+	{
+		std::size_t offset = masks_.size();
+		masks_.resize(offset + words_, 0);
+		for (auto& name : disabledNames)
+		{
+			std::size_t disabledBit = bit(name);
+			if (disabledBit < names_.size())
+			{
+				masks_[offset + disabledBit / 64] |= std::uint64_t(1) << (disabledBit % 64);
+			}
+		}
+		labels_.push_back(std::move(label));
+		return static_cast<std::uint32_t>(labels_.size() - 1);
+	}
+
+	std::uint32_t CompiledDontCares::findMask(const Rule& rule, const Parameter& value) const
+	{
+		if (rule.totalMask != noRule)
+		{
+			return rule.totalMask;
+		}
+		auto it = std::lower_bound(rule.values.begin(), rule.values.end(), value,
+			[](const auto& entry, const Parameter& val) { return entry.first < val; });
+		if (it == rule.values.end() || it->first != value)
+		{
+			return noRule;
+		}
+		return it->second;
+	}
+
+	std::size_t CompiledDontCares::bit(const std::string& name) const
+	{
+		auto it = std::lower_bound(names_.begin(), names_.end(), name);
+		if (it == names_.end() || *it != name)
+		{
+			return names_.size();
+		}
+		return it - names_.begin();
+	}
+
+	bool CompiledDontCares::empty() const
+	{
+		return rules_.empty();
+	}
+
+	std::size_t CompiledDontCares::words() const
+	{
+		return words_;
+	}
+
+	const std::vector<std::string>& CompiledDontCares::names() const
+	{
+		return names_;
+	}
+
+	const std::string& CompiledDontCares::label(std::uint32_t applied) const
+	{
+		return labels_[applied];
+	}
+
+	void CompiledDontCares::apply(const std::size_t* valueIndices, std::uint64_t* present, std::vector<std::uint32_t>* applied) const
+	{
+		for (auto& rule : rules_)
+		{
+			if (!((present[rule.key / 64] >> (rule.key % 64)) & 1))
+			{
+				continue;
+			}
+			std::uint32_t mask = rule.maskByValueIndex[valueIndices[rule.key]];
+			if (mask == noRule)
+			{
+				continue;
+			}
+			const std::uint64_t* disabled = &masks_[mask * words_];
+			for (std::size_t word = 0; word < words_; ++word)
+			{
+				present[word] &= ~disabled[word];
+			}
+			if (applied)
+			{
+				applied->push_back(mask);
+			}
+		}
+	}
+
+	void CompiledDontCares::disabledParameters(const parameterInstanceMap_t& paramInstance, std::uint64_t* disabled,
+		std::vector<std::uint32_t>* applied) const
+	{
+		for (auto& rule : rules_)
+		{
+			if ((disabled[rule.key / 64] >> (rule.key % 64)) & 1)
+			{
+				continue;
+			}
+			auto param = paramInstance.find(names_[rule.key]);
+			if (param == paramInstance.end())
+			{
+				continue;
+			}
+			std::uint32_t mask = findMask(rule, param->second);
+			if (mask == noRule)
+			{
+				continue;
+			}
+			const std::uint64_t* ruleMask = &masks_[mask * words_];
+			for (std::size_t word = 0; word < words_; ++word)
+			{
+				disabled[word] |= ruleMask[word];
+			}
+			if (applied)
+			{
+				applied->push_back(mask);
+			}
+		}
+	}
+
+	void CompiledDontCares::removeDisabledParameters(parameterInstanceMap_t& paramInstance, std::vector<std::uint32_t>* applied) const
+	{
+		ParameterMask disabled(words_);
+		disabledParameters(paramInstance, disabled.data(), applied);
+		for (std::size_t bit = 0; bit < names_.size(); ++bit)
+		{
+			if (disabled.test(bit))
+			{
+				paramInstance.erase(names_[bit]);
+			}
+		}
+	}
+
+} // Namespace parameterCombinator
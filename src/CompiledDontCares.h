@@ -0,0 +1,84 @@
+#pragma once
+#include "Parameters.h"
+#include <array>
+
+namespace parameterCombinator
+{
+	// Bitmask with one bit per indexed parameter. Small masks live on the stack.
+	class ParameterMask
+	{
+	public:
+		explicit ParameterMask(std::size_t words);
+		std::uint64_t* data();
+		const std::uint64_t* data() const;
+		std::size_t words() const;
+		bool test(std::size_t bit) const;
+		void set(std::size_t bit);
+	private:
+		static constexpr std::size_t inlineWords = 8;
+		std::size_t words_;
+		std::array<std::uint64_t, inlineWords> inline_;
+		std::vector<std::uint64_t> heap_;
+	};
+
+	// dontCares_t compiled once into an immutable table. Parameters are numbered in name order and every
+	// (parameter, value) rule becomes a mask of the parameters it disables. Applying all rules to a combination is
+	// then a few AND-NOT operations per rule.
+	//
+	// Rules are applied in dontCares_t key order and a rule only fires while its parameter is still present, so
+	// chains (a rule disabling the parameter of a later rule) resolve exactly as erasing names one by one did.
+	class CompiledDontCares
+	{
+	public:
+		static constexpr std::uint32_t noRule = 0xFFFFFFFF;
+
+		// Indexes every parameter named in 'dontCares'. Used to canonicalize arbitrary instances.
+		explicit CompiledDontCares(const dontCares_t& dontCares);
+		// Indexes the parameters of 'paramCombs' only, in its order, and resolves rule values to the value indices
+		// of its ParametersVecs. Used to generate combinations.
+		CompiledDontCares(const dontCares_t& dontCares, const parameterCombinations_t& paramCombs);
+
+		bool empty() const;
+		std::size_t words() const;
+		// Indexed parameter names, sorted
+		const std::vector<std::string>& names() const;
+
+		// Clears from 'present' the parameters disabled in the combination with the given value indices (one per
+		// parameter of paramCombs). Only valid when compiled against a parameterCombinations_t.
+		// The labels of the rules that fired are appended to 'applied' when given.
+		void apply(const std::size_t* valueIndices, std::uint64_t* present, std::vector<std::uint32_t>* applied = nullptr) const;
+		// Sets in 'disabled' the indexed parameters that the rules remove from 'paramInstance'
+		void disabledParameters(const parameterInstanceMap_t& paramInstance, std::uint64_t* disabled,
+			std::vector<std::uint32_t>* applied = nullptr) const;
+		// Erases from 'paramInstance' the parameters the rules disable
+		void removeDisabledParameters(parameterInstanceMap_t& paramInstance, std::vector<std::uint32_t>* applied = nullptr) const;
+		// "parameter=value" for value rules, "parameter" for total don't cares
+		const std::string& label(std::uint32_t applied) const;
+
+	private:
+		struct Rule
+		{
+			// Bit of the parameter the rule is keyed on
+			std::size_t key;
+			// Mask applied whatever the value is (total don't care), or noRule
+			std::uint32_t totalMask = noRule;
+			// Rule values sorted with operator< and their masks
+			std::vector<std::pair<Parameter, std::uint32_t>> values;
+			// Mask per value index of the key's ParametersVec, or noRule
+			std::vector<std::uint32_t> maskByValueIndex;
+		};
+
+		void compile(const dontCares_t& dontCares);
+		std::uint32_t addMask(const std::set<std::string>& disabledNames, std::string label);
+		std::uint32_t findMask(const Rule& rule, const Parameter& value) const;
+		std::size_t bit(const std::string& name) const;
+
+		std::vector<std::string> names_;
+		std::size_t words_ = 1;
+		std::vector<Rule> rules_;
+		// Mask m occupies words [m * words_, (m + 1) * words_)
+		std::vector<std::uint64_t> masks_;
+		std::vector<std::string> labels_;
+	};
+
+} // Namespace parameterCombinator
@@ -0,0 +1,266 @@
+#include "CompressedCombinations.h"
+#include <algorithm>
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// Bits needed to store every number from 0 to 'maximum'
+		unsigned bitsFor(std::uint64_t maximum)
+		{
+			unsigned bits = 0;
+			for (; maximum; maximum >>= 1)
+			{
+				++bits;
+			}
+			return bits;
+		}
+
+		// Appends fields of up to 32 bits, least significant bit first
+		void putBits(std::vector<std::uint64_t>& words, std::uint64_t& bitCount, std::uint64_t value, unsigned bits)
+		{
+			if (!bits)
+			{
+				return;
+			}
+			unsigned offset = static_cast<unsigned>(bitCount % 64);
+			if (!offset)
+			{
+				words.push_back(0);
+			}
+			words.back() |= value << offset;
+			if (offset + bits > 64)
+			{
+				words.push_back(value >> (64 - offset));
+			}
+			bitCount += bits;
+		}
+
+		class BitReader
+		{
+		public:
+			BitReader(const std::vector<std::uint64_t>& words, std::uint64_t position)
+				: words_(words), position_(position)
+			{
+			}
+			std::uint32_t get(unsigned bits)
+			{
+				if (!bits)
+				{
+					return 0;
+				}
+				std::size_t word = static_cast<std::size_t>(position_ / 64);
+				unsigned offset = static_cast<unsigned>(position_ % 64);
+				std::uint64_t value = words_[word] >> offset;
+				if (offset + bits > 64)
+				{
+					value |= words_[word + 1] << (64 - offset);
+				}
+				position_ += bits;
+				return static_cast<std::uint32_t>(value & ((std::uint64_t(1) << bits) - 1));
+			}
+		private:
+			const std::vector<std::uint64_t>& words_;
+			std::uint64_t position_;
+		};
+	}
+
+	CompressedCombinations::CompressedCombinations(const parameterCombinations_t& paramCombs, std::size_t blockRows)
+		: blockRows_(blockRows)
+	{
+		if (!blockRows_)
+		{
+			throw std::invalid_argument("Blocks must hold at least one row.");
+		}
+		for (auto& [name, values] : paramCombs)
+		{
+			addColumn(name, values);
+		}
+		prefixBits_ = bitsFor(names_.size());
+	}
+
+	CompressedCombinations::CompressedCombinations(const parameterInstanceSet_t& paramSet, std::size_t blockRows)
+		: blockRows_(blockRows)
+	{
+		if (!blockRows_)
+		{
+			throw std::invalid_argument("Blocks must hold at least one row.");
+		}
+		std::map<std::string, std::set<Parameter>> columns;
+		for (auto& paramInstance : paramSet)
+		{
+			for (auto& [name, value] : paramInstance)
+			{
+				columns[name].insert(value);
+			}
+		}
+		for (auto& [name, values] : columns)
+		{
+			ParametersVec valuesVec;
+			for (auto& value : values)
+			{
+				valuesVec.push_back(value);
+			}
+			addColumn(name, valuesVec);
+		}
+		prefixBits_ = bitsFor(names_.size());
+		for (auto& paramInstance : paramSet)
+		{
+			append(paramInstance);
+		}
+	}
+
+	void CompressedCombinations::addColumn(const std::string& name, const ParametersVec& values)
+	{
+		names_.push_back(name);
+		dictionaries_.emplace_back(values);
+		codeBits_.push_back(bitsFor(dictionaries_.back().size()));
+		lastCodes_.push_back(0);
+	}
+
+	void CompressedCombinations::append(const parameterInstanceMap_t& paramInstance)
+	{
+		codes_t codes(names_.size(), 0);
+		// Both are sorted by name
+		std::size_t column = 0;
+		for (auto& [name, value] : paramInstance)
+		{
+			while (column < names_.size() && names_[column] < name)
+			{
+				++column;
+			}
+			if (column == names_.size() || names_[column] != name)
+			{
+				throw std::invalid_argument("Parameter " + name + " has no column.");
+			}
+			auto rank = dictionaries_[column].find(value);
+			if (!rank)
+			{
+				throw std::invalid_argument("Value " + value->toString() + " of parameter " + name + " has no code.");
+			}
+			codes[column] = *rank + 1;
+		}
+
+		std::size_t changedFrom = 0;
+		if (rows_ % blockRows_ == 0)
+		{
+			blockOffsets_.push_back(bitCount_);
+		}
+		else
+		{
+			while (changedFrom < codes.size() && codes[changedFrom] == lastCodes_[changedFrom])
+			{
+				++changedFrom;
+			}
+			putBits(words_, bitCount_, changedFrom, prefixBits_);
+		}
+		for (column = changedFrom; column < codes.size(); ++column)
+		{
+			putBits(words_, bitCount_, codes[column], codeBits_[column]);
+		}
+		lastCodes_ = std::move(codes);
+		++rows_;
+	}
+
+	std::size_t CompressedCombinations::size() const
+	{
+		return rows_;
+	}
+
+	std::size_t CompressedCombinations::bytes() const
+	{
+		return words_.capacity() * sizeof(std::uint64_t) + blockOffsets_.capacity() * sizeof(std::uint64_t);
+	}
+
+	const std::vector<std::string>& CompressedCombinations::names() const
+	{
+		return names_;
+	}
+
+	const Parameter& CompressedCombinations::value(std::size_t column, std::uint32_t code) const
+	{
+		if (column >= names_.size() || code == 0 || code > dictionaries_[column].size())
+		{
+			throw std::invalid_argument("No value has this code.");
+		}
+		return dictionaries_[column].value(code - 1);
+	}
+
+	void CompressedCombinations::decode(std::size_t first, std::size_t last,
+		const std::function<void(const codes_t&, std::size_t changedFrom)>& callback) const
+	{
+		last = std::min(last, rows_);
+		if (first >= last)
+		{
+			return;
+		}
+		std::size_t block = first / blockRows_;
+		BitReader reader(words_, blockOffsets_[block]);
+		codes_t codes(names_.size(), 0);
+		// The first row handed out is reported as entirely changed
+		std::size_t changedFrom = 0;
+		for (std::size_t row = block * blockRows_; row < last; ++row)
+		{
+			std::size_t shared = 0;
+			if (row % blockRows_)
+			{
+				shared = reader.get(prefixBits_);
+			}
+			for (std::size_t column = shared; column < codes.size(); ++column)
+			{
+				codes[column] = reader.get(codeBits_[column]);
+			}
+			changedFrom = std::min(changedFrom, shared);
+			if (row >= first)
+			{
+				callback(codes, changedFrom);
+				changedFrom = codes.size();
+			}
+		}
+	}
+
+	parameterInstanceMap_t CompressedCombinations::at(std::size_t row) const
+	{
+		if (row >= rows_)
+		{
+			throw std::out_of_range("CompressedCombinations row out of range.");
+		}
+		parameterInstanceMap_t paramInstance;
+		forEach([&](const parameterInstanceMap_t& decoded)
+		{
+			paramInstance = decoded;
+		}, row, row + 1);
+		return paramInstance;
+	}
+
+	void CompressedCombinations::forEach(const std::function<void(const parameterInstanceMap_t&)>& callback,
+		std::size_t first, std::size_t last) const
+	{
+		parameterInstanceMap_t paramInstance;
+		decode(first, last, [&](const codes_t& codes, std::size_t changedFrom)
+		{
+			for (std::size_t column = changedFrom; column < codes.size(); ++column)
+			{
+				if (codes[column])
+				{
+					paramInstance.insert_or_assign(names_[column], dictionaries_[column].value(codes[column] - 1));
+				}
+				else
+				{
+					paramInstance.erase(names_[column]);
+				}
+			}
+			callback(paramInstance);
+		});
+	}
+
+	void CompressedCombinations::forEachCodes(const std::function<void(const codes_t&)>& callback,
+		std::size_t first, std::size_t last) const
+	{
+		decode(first, last, [&](const codes_t& codes, std::size_t)
+		{
+			callback(codes);
+		});
+	}
+
+} // Namespace parameterCombinator
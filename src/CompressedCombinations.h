@@ -0,0 +1,63 @@
+#pragma once
+#include "ParameterCombinator.h"
+
+namespace parameterCombinator
+{
+	// Compressed, append-only list of combinations for result sets too large to keep as maps, e.g. the stream of an
+	// ExternalCombinator. Every parameter is a column of codes: 0 when absent, else 1 + the rank of the value in the
+	// column's ValueDictionary, packed in as few bits as the column needs. Rows are grouped in blocks. The first row of
+	// a block is stored whole. Every other row stores how many leading columns it shares with the previous row and
+	// then only the codes of the columns after them. Rows in result set order mostly differ in their last parameters,
+	// so they take a few bits each. A block index gives random access to any block.
+	class CompressedCombinations
+	{
+	public:
+		using codes_t = std::vector<std::uint32_t>;
+		static constexpr std::size_t end = static_cast<std::size_t>(-1);
+
+		// Columns are the parameters of 'paramCombs', rows are added with append()
+		explicit CompressedCombinations(const parameterCombinations_t& paramCombs, std::size_t blockRows = 128);
+		// Compresses 'paramSet' in its order. Columns are the parameters of its combinations.
+		explicit CompressedCombinations(const parameterInstanceSet_t& paramSet, std::size_t blockRows = 128);
+
+		// Throws std::invalid_argument if the combination holds a parameter or value without a column or code
+		void append(const parameterInstanceMap_t& paramInstance);
+		std::size_t size() const;
+		// Bytes of the packed rows and the block index
+		std::size_t bytes() const;
+		// Parameter name of every column, sorted
+		const std::vector<std::string>& names() const;
+		// Value of a code other than 0
+		const Parameter& value(std::size_t column, std::uint32_t code) const;
+
+		// Decodes a row from the start of its block
+		parameterInstanceMap_t at(std::size_t row) const;
+		// Calls 'callback' with rows [first, last) in order. The map is updated in place from row to row.
+		void forEach(const std::function<void(const parameterInstanceMap_t&)>& callback,
+			std::size_t first = 0, std::size_t last = end) const;
+		// Same with the codes of every column, without building maps
+		void forEachCodes(const std::function<void(const codes_t&)>& callback,
+			std::size_t first = 0, std::size_t last = end) const;
+
+	private:
+		void addColumn(const std::string& name, const ParametersVec& values);
+		// Decodes rows [first, last), starting from the block holding 'first'. 'callback' gets the codes and the
+		// first column that changed since the previous row it was called with.
+		void decode(std::size_t first, std::size_t last,
+			const std::function<void(const codes_t&, std::size_t changedFrom)>& callback) const;
+
+		std::size_t blockRows_;
+		std::vector<std::string> names_;
+		std::vector<ValueDictionary> dictionaries_;
+		std::vector<unsigned> codeBits_;
+		unsigned prefixBits_ = 0;
+
+		std::vector<std::uint64_t> words_;
+		std::uint64_t bitCount_ = 0;
+		// Bit offset of every block
+		std::vector<std::uint64_t> blockOffsets_;
+		std::size_t rows_ = 0;
+		codes_t lastCodes_;
+	};
+
+} // Namespace parameterCombinator
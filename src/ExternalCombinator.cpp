@@ -0,0 +1,360 @@
+#include "ExternalCombinator.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// Creates uniquely named run files and removes them again, also when the combine throws
+		class TempFiles
+		{
+		public:
+			explicit TempFiles(const std::string& directory)
+				: directory_(directory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(directory))
+			{
+				std::random_device random;
+				std::ostringstream prefix;
+				prefix << "parameterCombinator-" << std::hex << random() << random() << "-";
+				prefix_ = prefix.str();
+			}
+			TempFiles(const TempFiles&) = delete;
+			TempFiles& operator=(const TempFiles&) = delete;
+			~TempFiles()
+			{
+				for (auto& path : paths_)
+				{
+					std::error_code error;
+					std::filesystem::remove(path, error);
+				}
+			}
+			std::string create()
+			{
+				paths_.push_back((directory_ / (prefix_ + std::to_string(paths_.size()) + ".run")).string());
+				return paths_.back();
+			}
+			void remove(const std::string& path)
+			{
+				std::error_code error;
+				std::filesystem::remove(path, error);
+			}
+		private:
+			std::filesystem::path directory_;
+			std::string prefix_;
+			std::vector<std::string> paths_;
+		};
+
+		class RunWriter
+		{
+		public:
+			explicit RunWriter(const std::string& path)
+				: path_(path), out_(path, std::ios::binary | std::ios::trunc)
+			{
+				if (!out_)
+				{
+					throw std::runtime_error("Cannot create " + path_);
+				}
+			}
+			void write(const std::uint32_t* row, std::size_t width)
+			{
+				out_.write(reinterpret_cast<const char*>(row), static_cast<std::streamsize>(width * sizeof(std::uint32_t)));
+				bytes_ += width * sizeof(std::uint32_t);
+			}
+			// Returns the bytes written
+			std::uint64_t close()
+			{
+				out_.close();
+				if (out_.fail())
+				{
+					throw std::runtime_error("Cannot write " + path_);
+				}
+				return bytes_;
+			}
+		private:
+			std::string path_;
+			std::ofstream out_;
+			std::uint64_t bytes_ = 0;
+		};
+
+		class RunReader
+		{
+		public:
+			RunReader(const std::string& path, std::size_t width, std::size_t bufferRows)
+				: path_(path), in_(path, std::ios::binary), width_(width), buffer_(width * bufferRows)
+			{
+				if (!in_)
+				{
+					throw std::runtime_error("Cannot open " + path_);
+				}
+			}
+			// Moves to the next row. Returns false at the end of the run.
+			bool next()
+			{
+				if (++position_ < rows_)
+				{
+					return true;
+				}
+				in_.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size() * sizeof(std::uint32_t)));
+				std::size_t bytes = static_cast<std::size_t>(in_.gcount());
+				if (bytes % (width_ * sizeof(std::uint32_t)))
+				{
+					throw std::runtime_error(path_ + " is truncated.");
+				}
+				rows_ = bytes / (width_ * sizeof(std::uint32_t));
+				position_ = 0;
+				return rows_ > 0;
+			}
+			const std::uint32_t* row() const
+			{
+				return buffer_.data() + position_ * width_;
+			}
+		private:
+			std::string path_;
+			std::ifstream in_;
+			std::size_t width_;
+			std::vector<std::uint32_t> buffer_;
+			std::size_t rows_ = 0;
+			std::size_t position_ = 0;
+		};
+
+		bool rowLess(const std::uint32_t* lhs, const std::uint32_t* rhs, std::size_t width)
+		{
+			return std::lexicographical_compare(lhs, lhs + width, rhs, rhs + width);
+		}
+
+		// Calls 'sink' with the distinct rows of the buffered rows in sorted order
+		void sortedUniqueRows(const std::vector<std::uint32_t>& rows, std::size_t width,
+			const std::function<void(const std::uint32_t*)>& sink)
+		{
+			std::vector<std::uint32_t> order(rows.size() / width);
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs)
+			{
+				return rowLess(&rows[lhs * width], &rows[rhs * width], width);
+			});
+			const std::uint32_t* previous = nullptr;
+			for (std::uint32_t idx : order)
+			{
+				const std::uint32_t* row = &rows[idx * width];
+				if (!previous || !std::equal(row, row + width, previous))
+				{
+					sink(row);
+				}
+				previous = row;
+			}
+		}
+
+		// Calls 'sink' with the distinct rows of the sorted runs in sorted order
+		void mergeRuns(const std::vector<std::string>& paths, std::size_t width, std::size_t bufferRows,
+			const std::function<void(const std::uint32_t*)>& sink)
+		{
+			std::vector<std::unique_ptr<RunReader>> readers;
+			auto greater = [&](std::size_t lhs, std::size_t rhs)
+			{
+				return rowLess(readers[rhs]->row(), readers[lhs]->row(), width);
+			};
+			std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(greater)> heap(greater);
+			for (auto& path : paths)
+			{
+				readers.push_back(std::make_unique<RunReader>(path, width, bufferRows));
+				if (readers.back()->next())
+				{
+					heap.push(readers.size() - 1);
+				}
+			}
+
+			std::vector<std::uint32_t> previous;
+			while (!heap.empty())
+			{
+				std::size_t reader = heap.top();
+				heap.pop();
+				const std::uint32_t* row = readers[reader]->row();
+				if (previous.empty() || !std::equal(row, row + width, previous.begin()))
+				{
+					previous.assign(row, row + width);
+					sink(row);
+				}
+				if (readers[reader]->next())
+				{
+					heap.push(reader);
+				}
+			}
+		}
+	}
+
+	ExternalCombinator::ExternalCombinator(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+		const ExternalCombineOptions& options)
+		: paramCombs_(paramCombs)
+		, rules_(dontCares, paramCombs_)
+		, options_(options)
+	{
+		if (options_.mergeFanIn < 2)
+		{
+			throw std::invalid_argument("ExternalCombineOptions::mergeFanIn must be at least 2.");
+		}
+		for (auto& [name, values] : paramCombs_)
+		{
+			Column column{ &name, &values, std::vector<std::uint32_t>(values.size()), {} };
+			std::vector<std::pair<Parameter, std::size_t>> sorted;
+			sorted.reserve(values.size());
+			for (std::size_t idx = 0; idx < values.size(); ++idx)
+			{
+				sorted.emplace_back(values[idx], idx);
+			}
+			std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+			for (std::size_t k = 0; k < sorted.size(); ++k)
+			{
+				if (k == 0 || sorted[k - 1].first < sorted[k].first)
+				{
+					column.indexByRank.push_back(sorted[k].second);
+				}
+				column.rankByIndex[sorted[k].second] = static_cast<std::uint32_t>(column.indexByRank.size());
+			}
+			if (column.indexByRank.size() >= absentInner)
+			{
+				throw std::invalid_argument("Parameter " + name + " has too many values for ExternalCombinator.");
+			}
+			columns_.push_back(std::move(column));
+		}
+		std::size_t rowBytes = (columns_.size() + 1) * sizeof(std::uint32_t);
+		if (options_.memoryBudget / rowBytes < options_.mergeFanIn + 1)
+		{
+			throw std::invalid_argument("ExternalCombineOptions::memoryBudget is too small for one row per merged run.");
+		}
+	}
+
+	parameterInstanceMap_t ExternalCombinator::makeInstance(const std::uint32_t* row) const
+	{
+		parameterInstanceMap_t paramInstance;
+		for (std::size_t i = 0; i < columns_.size(); ++i)
+		{
+			if (row[i] != absentTrailing && row[i] != absentInner)
+			{
+				const Column& column = columns_[i];
+				paramInstance.emplace_hint(paramInstance.end(), *column.name, (*column.values)[column.indexByRank[row[i] - 1]]);
+			}
+		}
+		return paramInstance;
+	}
+
+	ExternalCombineStats ExternalCombinator::run(const consumer_t& consumer) const
+	{
+		ExternalCombineStats stats;
+		const std::size_t width = columns_.size();
+		// Every buffered row also takes one entry in the sort order
+		const std::size_t bufferRows = std::min<std::size_t>(options_.memoryBudget / ((width + 1) * sizeof(std::uint32_t)),
+			std::numeric_limits<std::uint32_t>::max());
+		TempFiles tempFiles(options_.tempDirectory);
+		std::vector<std::string> runs;
+		std::vector<std::uint32_t> rows;
+		// Reserved up front so geometric growth can not take the buffer past the budget before it spills. Small
+		// products only reserve what they need.
+		std::size_t productRows = 1;
+		for (auto& column : columns_)
+		{
+			productRows = column.values->size() && productRows > bufferRows / column.values->size()
+				? bufferRows : productRows * column.values->size();
+		}
+		rows.reserve(std::min(bufferRows, productRows) * width);
+
+		auto spill = [&]()
+		{
+			std::string path = tempFiles.create();
+			RunWriter writer(path);
+			sortedUniqueRows(rows, width, [&](const std::uint32_t* row) { writer.write(row, width); });
+			stats.spilledBytes += writer.close();
+			runs.push_back(path);
+			rows.clear();
+		};
+
+		std::vector<const ParametersVec*> sequences;
+		for (auto& column : columns_)
+		{
+			sequences.push_back(column.values);
+		}
+		ParameterMask allPresent(rules_.words());
+		for (std::size_t i = 0; i < width; ++i)
+		{
+			allPresent.set(i);
+		}
+		ParameterCombinator::forEachCombination(sequences, [&](const std::vector<std::size_t>& indices)
+		{
+			++stats.rawCombinations;
+			ParameterMask present = allPresent;
+			rules_.apply(indices.data(), present.data());
+			std::size_t base = rows.size();
+			rows.resize(base + width);
+			bool laterPresent = false;
+			for (std::size_t i = width; i-- > 0;)
+			{
+				if (present.test(i))
+				{
+					rows[base + i] = columns_[i].rankByIndex[indices[i]];
+					laterPresent = true;
+				}
+				else
+				{
+					rows[base + i] = laterPresent ? absentInner : absentTrailing;
+				}
+			}
+			if (rows.size() / width >= bufferRows)
+			{
+				spill();
+			}
+		});
+
+		auto emit = [&](const std::uint32_t* row)
+		{
+			++stats.distinctCombinations;
+			consumer(makeInstance(row));
+		};
+		// Everything fit in memory
+		if (runs.empty())
+		{
+			if (!rows.empty())
+			{
+				sortedUniqueRows(rows, width, emit);
+			}
+			return stats;
+		}
+		if (!rows.empty())
+		{
+			spill();
+		}
+		std::vector<std::uint32_t>().swap(rows);
+		stats.runs = runs.size();
+
+		const std::size_t mergeBufferRows = bufferRows / (options_.mergeFanIn + 1);
+		while (runs.size() > options_.mergeFanIn)
+		{
+			std::vector<std::string> merged;
+			for (std::size_t first = 0; first < runs.size(); first += options_.mergeFanIn)
+			{
+				std::vector<std::string> inputs(runs.begin() + first,
+					runs.begin() + std::min(runs.size(), first + options_.mergeFanIn));
+				std::string path = tempFiles.create();
+				RunWriter writer(path);
+				mergeRuns(inputs, width, mergeBufferRows, [&](const std::uint32_t* row) { writer.write(row, width); });
+				stats.spilledBytes += writer.close();
+				for (auto& input : inputs)
+				{
+					tempFiles.remove(input);
+				}
+				merged.push_back(path);
+			}
+			runs = std::move(merged);
+			++stats.mergePasses;
+		}
+		++stats.mergePasses;
+		mergeRuns(runs, width, mergeBufferRows, emit);
+		return stats;
+	}
+
+} // Namespace parameterCombinator
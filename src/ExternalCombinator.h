@@ -0,0 +1,69 @@
+#pragma once
+#include "ParameterCombinator.h"
+
+namespace parameterCombinator
+{
+	struct ExternalCombineOptions
+	{
+		// Bytes of generated combinations held in memory. A sorted run is spilled to disk whenever it is reached,
+		// and the merge splits it between its input buffers.
+		std::size_t memoryBudget = std::size_t(256) << 20;
+		// Where the runs are written. Empty uses the system temporary directory.
+		std::string tempDirectory;
+		// Runs merged at once. More runs are merged in several passes.
+		std::size_t mergeFanIn = 64;
+	};
+
+	struct ExternalCombineStats
+	{
+		std::uint64_t rawCombinations = 0;
+		std::uint64_t distinctCombinations = 0;
+		// Sorted runs written during generation, and the merge passes needed to bring them down to one
+		std::size_t runs = 0;
+		std::size_t mergePasses = 0;
+		std::uint64_t spilledBytes = 0;
+	};
+
+	// Combines parameter spaces whose distinct combinations do not fit in memory. Every combination is reduced to one
+	// 32 bit value rank per parameter. Ranks are buffered up to the memory budget, sorted, deduplicated and spilled
+	// to temporary files, which are then k-way merged. The distinct combinations are streamed out in the order of
+	// ParameterCombinator's result set, built one at a time.
+	class ExternalCombinator
+	{
+	public:
+		using consumer_t = std::function<void(const parameterInstanceMap_t&)>;
+
+		ExternalCombinator(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+			const ExternalCombineOptions& options = ExternalCombineOptions{});
+		ExternalCombinator(const ExternalCombinator&) = delete;
+		ExternalCombinator& operator=(const ExternalCombinator&) = delete;
+
+		// Calls 'consumer' once per distinct combination. Temporary files are removed before returning.
+		ExternalCombineStats run(const consumer_t& consumer) const;
+
+	private:
+		// Row entry of a parameter removed by a don't care: before every value when no later parameter is present,
+		// after every value otherwise. This makes row order equal to ParameterInstanceSetCompare order.
+		static constexpr std::uint32_t absentTrailing = 0;
+		static constexpr std::uint32_t absentInner = 0xFFFFFFFF;
+
+		struct Column
+		{
+			const std::string* name;
+			const ParametersVec* values;
+			// Rank of each value index, starting at 1. Equal values share a rank.
+			std::vector<std::uint32_t> rankByIndex;
+			// Value index of each rank
+			std::vector<std::size_t> indexByRank;
+		};
+
+		parameterInstanceMap_t makeInstance(const std::uint32_t* row) const;
+
+		parameterCombinations_t paramCombs_;
+		CompiledDontCares rules_;
+		ExternalCombineOptions options_;
+		// One per parameter of paramCombs_, in name order
+		std::vector<Column> columns_;
+	};
+
+} // Namespace parameterCombinator
@@ -0,0 +1,117 @@
+#include "FanOut.h"
+#include <algorithm>
+
+namespace parameterCombinator
+{
+	FanOut::FanOut(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares)
+		: paramCombs_(paramCombs)
+		, rules_(dontCares, paramCombs_)
+	{
+		for (auto& [name, values] : paramCombs_)
+		{
+			names_.push_back(&name);
+			values_.push_back(&values);
+		}
+	}
+
+	std::vector<std::string> FanOut::collapsedParameters(const parameterInstanceMap_t& paramInstance) const
+	{
+		std::vector<std::string> collapsed;
+		for (auto* name : names_)
+		{
+			if (!paramInstance.count(*name))
+			{
+				collapsed.push_back(*name);
+			}
+		}
+		return collapsed;
+	}
+
+	std::uint64_t FanOut::count(const parameterInstanceMap_t& paramInstance) const
+	{
+		return forEachRaw(paramInstance, [](const std::vector<std::size_t>&) {});
+	}
+
+	std::uint64_t FanOut::expand(const parameterInstanceMap_t& paramInstance, const rawCallback_t& callback) const
+	{
+		return forEachRaw(paramInstance, [&](const std::vector<std::size_t>& indices)
+		{
+			parameterInstanceMap_t rawInstance;
+			for (std::size_t i = 0; i < names_.size(); ++i)
+			{
+				rawInstance.emplace_hint(rawInstance.end(), *names_[i], (*values_[i])[indices[i]]);
+			}
+			callback(rawInstance);
+		});
+	}
+
+	std::uint64_t FanOut::forEachRaw(const parameterInstanceMap_t& paramInstance,
+		const std::function<void(const std::vector<std::size_t>&)>& callback) const
+	{
+		// Candidate value indices per parameter: the indices holding the instance's value, or all of them for a
+		// collapsed parameter
+		std::vector<std::vector<std::size_t>> candidates(names_.size());
+		ParameterMask expected(rules_.words());
+		std::size_t held = 0;
+		for (std::size_t i = 0; i < names_.size(); ++i)
+		{
+			auto value = paramInstance.find(*names_[i]);
+			if (value != paramInstance.end())
+			{
+				++held;
+				expected.set(i);
+			}
+			for (std::size_t idx = 0; idx < values_[i]->size(); ++idx)
+			{
+				if (value == paramInstance.end() || (*values_[i])[idx] == value->second)
+				{
+					candidates[i].push_back(idx);
+				}
+			}
+			if (candidates[i].empty())
+			{
+				return 0;
+			}
+		}
+		// Parameters outside the spec never come out of combine()
+		if (names_.empty() || held != paramInstance.size())
+		{
+			return 0;
+		}
+
+		ParameterMask allPresent(rules_.words());
+		for (std::size_t i = 0; i < names_.size(); ++i)
+		{
+			allPresent.set(i);
+		}
+		std::vector<std::size_t> positions(names_.size(), 0);
+		std::vector<std::size_t> indices(names_.size());
+		std::uint64_t matches = 0;
+		while (true)
+		{
+			for (std::size_t i = 0; i < names_.size(); ++i)
+			{
+				indices[i] = candidates[i][positions[i]];
+			}
+			// The raw combination reduces to the instance when the rules remove exactly its collapsed parameters
+			ParameterMask present = allPresent;
+			rules_.apply(indices.data(), present.data());
+			if (std::equal(present.data(), present.data() + present.words(), expected.data()))
+			{
+				++matches;
+				callback(indices);
+			}
+
+			std::size_t digit = positions.size();
+			while (digit > 0 && ++positions[digit - 1] == candidates[digit - 1].size())
+			{
+				positions[--digit] = 0;
+			}
+			if (digit == 0)
+			{
+				return matches;
+			}
+		}
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,37 @@
+#pragma once
+#include "ParameterCombinator.h"
+
+namespace parameterCombinator
+{
+	// Maps the distinct combinations of combine() back to the raw Cartesian combinations that don't cares and
+	// duplicate values collapsed into them, so one evaluated result can be reported for every raw combination
+	// without evaluating it again.
+	class FanOut
+	{
+	public:
+		using rawCallback_t = std::function<void(const parameterInstanceMap_t&)>;
+
+		FanOut(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares);
+
+		// Parameters of the spec that 'paramInstance' does not hold. Together with the instance they describe its
+		// raw combinations: every value of each collapsed parameter.
+		std::vector<std::string> collapsedParameters(const parameterInstanceMap_t& paramInstance) const;
+		// Number of raw combinations combine() reduces to 'paramInstance'
+		std::uint64_t count(const parameterInstanceMap_t& paramInstance) const;
+		// Calls 'callback' with each raw combination, holding every parameter of the spec, that combine() reduces
+		// to 'paramInstance'. Returns their number.
+		std::uint64_t expand(const parameterInstanceMap_t& paramInstance, const rawCallback_t& callback) const;
+
+	private:
+		// Calls 'callback' with the value indices of every raw combination that reduces to 'paramInstance'
+		std::uint64_t forEachRaw(const parameterInstanceMap_t& paramInstance,
+			const std::function<void(const std::vector<std::size_t>&)>& callback) const;
+
+		parameterCombinations_t paramCombs_;
+		CompiledDontCares rules_;
+		// Parameter names and values of paramCombs_, in name order
+		std::vector<const std::string*> names_;
+		std::vector<const ParametersVec*> values_;
+	};
+
+} // Namespace parameterCombinator
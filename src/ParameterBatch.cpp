@@ -0,0 +1,103 @@
+#include "ParameterBatch.h"
+#include <algorithm>
+
+namespace parameterCombinator
+{
+	ParameterBatch::ParameterBatch()
+	{
+	}
+
+	std::size_t ParameterBatch::size() const
+	{
+		return instances_.size();
+	}
+
+	const std::vector<std::string>& ParameterBatch::names() const
+	{
+		return names_;
+	}
+
+	bool ParameterBatch::hasColumn(const std::string& name) const
+	{
+		return std::binary_search(names_.begin(), names_.end(), name);
+	}
+
+	const ParameterBatch::Column& ParameterBatch::findColumn(const std::string& name) const
+	{
+		auto it = std::lower_bound(names_.begin(), names_.end(), name);
+		if (it == names_.end() || *it != name)
+		{
+			throw std::invalid_argument("Parameter " + name + " does not exist in this batch.");
+		}
+		return columns_[it - names_.begin()];
+	}
+
+	const std::uint64_t* ParameterBatch::presence(const std::string& name) const
+	{
+		return findColumn(name).presence.data();
+	}
+
+	bool ParameterBatch::isPresent(const std::string& name, std::size_t row) const
+	{
+		return (presence(name)[row / 64] >> (row % 64)) & 1;
+	}
+
+	const parameterInstanceMap_t& ParameterBatch::instance(std::size_t row) const
+	{
+		return *instances_.at(row);
+	}
+
+	void ParameterBatch::assign(const std::vector<const parameterInstanceMap_t*>& instances)
+	{
+		instances_ = instances;
+		names_.clear();
+		columns_.clear();
+
+		for (auto* paramInstance : instances_)
+		{
+			for (auto& param : *paramInstance)
+			{
+				names_.push_back(param.first);
+			}
+		}
+		std::sort(names_.begin(), names_.end());
+		names_.erase(std::unique(names_.begin(), names_.end()), names_.end());
+
+		const std::size_t rows = instances_.size();
+		const std::size_t words = (rows + 63) / 64;
+		columns_.resize(names_.size());
+		for (std::size_t col = 0; col < names_.size(); ++col)
+		{
+			Column& column = columns_[col];
+			column.presence.assign(words, 0);
+			// Absent rows hold a copy of the first value, so every row is a valid value of the right type
+			const ParameterBase* first = nullptr;
+			for (std::size_t row = 0; row < rows && !first; ++row)
+			{
+				auto param = instances_[row]->find(names_[col]);
+				if (param != instances_[row]->end())
+				{
+					first = &*param->second;
+				}
+			}
+			column.values = first->makeColumn(rows);
+			for (std::size_t row = 0; row < rows; ++row)
+			{
+				auto param = instances_[row]->find(names_[col]);
+				if (param == instances_[row]->end())
+				{
+					first->appendToColumn(*column.values);
+					continue;
+				}
+				const ParameterBase& value = *param->second;
+				if (typeid(value) != typeid(*first))
+				{
+					throw std::invalid_argument("Parameter " + names_[col] + " holds values of different types and cannot be stored in a typed column.");
+				}
+				value.appendToColumn(*column.values);
+				column.presence[row / 64] |= std::uint64_t(1) << (row % 64);
+			}
+		}
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,52 @@
+#pragma once
+#include "Parameters.h"
+
+namespace parameterCombinator
+{
+	// Block of combinations in structure-of-arrays form. Every parameter appearing in the block has a contiguous
+	// typed column with one entry per combination, plus a presence bitmask for combinations where it was removed
+	// by a don't care. Absent entries hold a copy of another value of the column and must be masked out.
+	class ParameterBatch
+	{
+	public:
+		ParameterBatch();
+
+		// Number of combinations in the block
+		std::size_t size() const;
+		// Parameters with a column in this block, in name order
+		const std::vector<std::string>& names() const;
+		bool hasColumn(const std::string& name) const;
+
+		template<typename T>
+		const T* column(const std::string& name) const
+		{
+			const Column& col = findColumn(name);
+			if (col.values->type() != typeid(T))
+			{
+				throw std::invalid_argument("Given template type does not match the column type of " + name + ".");
+			}
+			return static_cast<const ParameterColumn<T>&>(*col.values).data();
+		}
+		// Bit (row % 64) of word (row / 64) is set when the parameter is present in that row
+		const std::uint64_t* presence(const std::string& name) const;
+		bool isPresent(const std::string& name, std::size_t row) const;
+		// The combination a row was built from
+		const parameterInstanceMap_t& instance(std::size_t row) const;
+
+		// Rebuilds the block from 'instances'
+		void assign(const std::vector<const parameterInstanceMap_t*>& instances);
+
+	private:
+		struct Column
+		{
+			std::unique_ptr<ParameterColumnBase> values;
+			std::vector<std::uint64_t> presence;
+		};
+		const Column& findColumn(const std::string& name) const;
+
+		std::vector<const parameterInstanceMap_t*> instances_;
+		std::vector<std::string> names_;
+		std::vector<Column> columns_;
+	};
+
+} // Namespace parameterCombinator
@@ -2,140 +2,827 @@
 #include "ParameterCombinator.h"
 #include <sstream>
 #include <algorithm>
+#include <set>
+#include <mutex>
+#include <thread>
 
 namespace parameterCombinator
 {
 
-	void ParameterCombinator::CartesianRecurse(std::vector<std::vector<Parameter>>& accum, std::vector<Parameter> stack,
-		std::vector<std::vector<Parameter>> sequences, int64_t index)
+	void ParameterCombinator::forEachCombination(const std::vector<const ParametersVec*>& sequences,
+		const std::function<void(const std::vector<std::size_t>&)>& callback)
 	{
-		std::vector<Parameter> sequence = sequences[index];
-		for (auto i : sequence)
+		std::vector<std::size_t> sizes;
+		sizes.reserve(sequences.size());
+		for (auto& sequence : sequences)
 		{
-			stack.push_back(i);
-			if (index == 0) {
-				accum.push_back(stack);
+			sizes.push_back(sequence->size());
+		}
+		forEachIndexTuple(sizes, std::vector<std::size_t>(sizes.size(), std::string::npos), callback);
+	}
+
+	void ParameterCombinator::forEachIndexTuple(const std::vector<std::size_t>& sizes, const std::vector<std::size_t>& floors,
+		const std::function<void(const std::vector<std::size_t>&)>& callback)
+	{
+		if (sizes.empty())
+		{
+			return;
+		}
+		for (auto size : sizes)
+		{
+			if (!size)
+			{
+				return;
+			}
+		}
+		// Odometer over the value indices. Values are only materialized by the callback,
+		// so lazy ParametersVecs never need to be expanded in memory.
+		std::vector<std::size_t> indices(sizes.size(), 0);
+		while (true)
+		{
+			callback(indices);
+			std::size_t digit = indices.size();
+			while (digit > 0 && indices[digit - 1] + 1 == sizes[digit - 1])
+			{
+				--digit;
 			}
-			else {
-				CartesianRecurse(accum, stack, sequences, index - 1);
+			if (digit == 0)
+			{
+				return;
+			}
+			++indices[digit - 1];
+			// Floors always refer to earlier digits, which are final by now
+			for (; digit < indices.size(); ++digit)
+			{
+				indices[digit] = floors[digit] == std::string::npos ? 0 : indices[floors[digit]];
 			}
-			stack.pop_back();
 		}
 	}
 
-	std::vector<std::vector<Parameter>> ParameterCombinator::CartesianProduct(std::vector<std::vector<Parameter>>& sequences)
+	bool Symmetries::empty() const
+	{
+		return interchangeable.empty() && collapsedValues.empty();
+	}
+
+	namespace
 	{
-		std::vector<std::vector<Parameter>> accum;
-		std::vector<Parameter> stack;
-		if (sequences.size() > 0) {
-			CartesianRecurse(accum, stack, sequences, sequences.size() - 1);
+		// Rules shared by a result set to strip lookup probes, null without don't cares
+		std::shared_ptr<const CompiledDontCares> compileRules(const dontCares_t& dontCares)
+		{
+			auto rules = std::make_shared<const CompiledDontCares>(dontCares);
+			return rules->empty() ? nullptr : rules;
 		}
-		return accum;
+
+		// Value indices combined for every parameter of 'paramCombs' and the floors of forEachIndexTuple() making the
+		// parameters of every interchangeable group non-decreasing
+		struct SymmetryReduction
+		{
+			SymmetryReduction(const parameterCombinations_t& paramCombs, const Symmetries& symmetries)
+			{
+				std::map<std::string, std::size_t> digits;
+				std::vector<const std::string*> names;
+				for (auto& [name, values] : paramCombs)
+				{
+					std::size_t digit = digits.size();
+					digits.emplace(name, digit);
+					names.push_back(&name);
+					sequences_.push_back(&values);
+					kept_.emplace_back();
+					floors_.push_back(std::string::npos);
+				}
+				for (auto& [name, groups] : symmetries.collapsedValues)
+				{
+					auto digit = digits.find(name);
+					if (digit == digits.end())
+					{
+						throw std::invalid_argument("Collapsed values given for unknown parameter " + name + ".");
+					}
+					keepRepresentatives(digit->second, groups);
+				}
+				std::vector<bool> grouped(digits.size(), false);
+				for (auto& group : symmetries.interchangeable)
+				{
+					std::vector<std::size_t> members;
+					for (auto& name : group)
+					{
+						auto digit = digits.find(name);
+						if (digit == digits.end())
+						{
+							throw std::invalid_argument("Interchangeable parameter " + name + " is not combined.");
+						}
+						if (grouped[digit->second])
+						{
+							throw std::invalid_argument("Parameter " + name + " belongs to more than one interchangeable group.");
+						}
+						grouped[digit->second] = true;
+						members.push_back(digit->second);
+					}
+					std::sort(members.begin(), members.end());
+					for (std::size_t member = 1; member < members.size(); ++member)
+					{
+						if (!sameValues(members[0], members[member]))
+						{
+							throw std::invalid_argument("Interchangeable parameters " + *names[members[0]] + " and " +
+								*names[members[member]] + " have different values.");
+						}
+						floors_[members[member]] = members[member - 1];
+					}
+				}
+			}
+			std::vector<std::size_t> sizes() const
+			{
+				std::vector<std::size_t> sizes;
+				for (std::size_t digit = 0; digit < sequences_.size(); ++digit)
+				{
+					sizes.push_back(size(digit));
+				}
+				return sizes;
+			}
+			const std::vector<std::size_t>& floors() const
+			{
+				return floors_;
+			}
+			// Index into the parameter's ParametersVec of the index'th value combined
+			std::size_t original(std::size_t digit, std::size_t index) const
+			{
+				return kept_[digit].empty() ? index : kept_[digit][index];
+			}
+		private:
+			std::size_t size(std::size_t digit) const
+			{
+				return kept_[digit].empty() ? sequences_[digit]->size() : kept_[digit].size();
+			}
+			void keepRepresentatives(std::size_t digit, const std::vector<std::vector<Parameter>>& groups)
+			{
+				std::set<Parameter> dropped;
+				for (auto& group : groups)
+				{
+					for (std::size_t value = 1; value < group.size(); ++value)
+					{
+						dropped.insert(group[value]);
+					}
+				}
+				for (std::size_t index = 0; index < sequences_[digit]->size(); ++index)
+				{
+					if (!dropped.count((*sequences_[digit])[index]))
+					{
+						kept_[digit].push_back(index);
+					}
+				}
+				// An empty list stands for every value
+				if (kept_[digit].empty() && sequences_[digit]->size())
+				{
+					throw std::invalid_argument("Equivalent values drop every value of a parameter.");
+				}
+			}
+			bool sameValues(std::size_t lhs, std::size_t rhs) const
+			{
+				if (size(lhs) != size(rhs))
+				{
+					return false;
+				}
+				for (std::size_t index = 0; index < size(lhs); ++index)
+				{
+					if ((*sequences_[lhs])[original(lhs, index)] != (*sequences_[rhs])[original(rhs, index)])
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			std::vector<const ParametersVec*> sequences_;
+			std::vector<std::vector<std::size_t>> kept_;
+			std::vector<std::size_t> floors_;
+		};
 	}
 
-	void ParameterCombinator::combine(parameterCombinations_t& paramCombs, dontCares_t& dontCares)
+	void ParameterCombinator::combine(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares, const CombineOptions& options)
 	{
+		auto start = std::chrono::steady_clock::now();
+		// Remove repeated combinations taking into account don't care parameters
+		auto storage = beginCombine(dontCares, options);
+		generate(*storage, paramCombs, dontCares, options);
+		finishCombine(std::move(storage), options, start);
+	}
 
-		// Convert parameterCombinations_t to a vector of vector of ints
-		std::vector<std::vector<Parameter>> sequences;
+	void ParameterCombinator::combine(const ParameterSpace& paramSpace, const dontCares_t& dontCares, const CombineOptions& options)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto storage = beginCombine(dontCares, options);
+		generate(*storage, paramSpace, dontCares, options);
+		finishCombine(std::move(storage), options, start);
+	}
+
+	void ParameterCombinator::generate(ParameterInstanceStorage& storage, const parameterCombinations_t& paramCombs,
+		const dontCares_t& dontCares, const CombineOptions& options)
+	{
+		std::vector<const ParametersVec*> sequences;
 		std::vector<std::string> keyOrder;
+		sequences.reserve(paramCombs.size());
+		keyOrder.reserve(paramCombs.size());
 		for (auto& param : paramCombs) {
-			std::vector<Parameter> seq;
 			keyOrder.push_back(param.first);
-			for (auto& val : param.second) {
-				seq.emplace_back(val);
-			}
-			sequences.push_back(seq);
+			sequences.push_back(&param.second);
 		}
 
-		std::vector<std::vector<Parameter>> combinations = CartesianProduct(sequences);
-
-		// Remove repeated combinations taking into account don't care parameters
-		ParameterInstanceSetCompare cmp(dontCares);
-		*parameterInstanceSet_.get() = parameterInstanceSet_t(cmp);
+		CompiledDontCares rules(dontCares, paramCombs);
+		ParameterMask allPresent(rules.words());
+		for (std::size_t i = 0; i < keyOrder.size(); ++i)
+		{
+			allPresent.set(i);
+		}
+		std::vector<std::uint32_t> appliedRules;
 
-		for (auto& combination : combinations)
+		// Interned values make every comparison of the result set a rank compare. Lazy ParametersVecs are not
+		// interned, so their values are still only produced when a combination uses them.
+		std::vector<std::unique_ptr<ValueDictionary>> dictionaries;
+		dictionaries.reserve(sequences.size());
+		for (auto* sequence : sequences)
 		{
+			dictionaries.push_back(sequence->isLazy() ? nullptr : std::make_unique<ValueDictionary>(*sequence));
+		}
+		SymmetryReduction reduction(paramCombs, options.symmetries);
+		std::vector<std::size_t> originalIndices(sequences.size());
+		forEachIndexTuple(reduction.sizes(), reduction.floors(), [&](const std::vector<std::size_t>& reducedIndices)
+		{
+			for (std::size_t i = 0; i < reducedIndices.size(); ++i)
+			{
+				originalIndices[i] = reduction.original(i, reducedIndices[i]);
+			}
+			const std::vector<std::size_t>& indices = originalIndices;
+			std::chrono::steady_clock::time_point dontCareStart;
+			if (options.stats)
+			{
+				appliedRules.clear();
+				dontCareStart = std::chrono::steady_clock::now();
+			}
+			ParameterMask present = allPresent;
+			rules.apply(indices.data(), present.data(), options.stats ? &appliedRules : nullptr);
+			std::chrono::nanoseconds dontCareTime{};
+			if (options.stats)
+			{
+				dontCareTime = std::chrono::steady_clock::now() - dontCareStart;
+			}
+
 			parameterInstanceMap_t paramInstance;
-			auto key = std::prev(keyOrder.end());
-			for (auto& param : combination)
+			for (std::size_t i = 0; i < indices.size(); ++i)
+			{
+				if (!present.test(i))
+				{
+					continue;
+				}
+				if (dictionaries[i])
+				{
+					paramInstance.emplace_hint(paramInstance.end(), keyOrder[i], (*dictionaries[i])[indices[i]]);
+				}
+				else
+				{
+					paramInstance.emplace_hint(paramInstance.end(), keyOrder[i], (*sequences[i])[indices[i]]);
+				}
+			}
+			storeInstance(storage, std::move(paramInstance), rules, appliedRules, dontCareTime, options);
+		});
+	}
+
+	void ParameterCombinator::generate(ParameterInstanceStorage& storage, const ParameterSpace& paramSpace,
+		const dontCares_t& dontCares, const CombineOptions& options)
+	{
+		if (!options.symmetries.empty())
+		{
+			throw std::invalid_argument("Symmetries are only supported when combining parameterCombinations_t.");
+		}
+		CompiledDontCares rules(dontCares);
+		if (!paramSpace.parameters.empty())
+		{
+			expandSpace(paramSpace, parameterInstanceMap_t{}, [&](parameterInstanceMap_t& paramInstance)
+			{
+				insertInstance(storage, paramInstance, rules, options);
+			});
+		}
+	}
+
+	void ParameterCombinator::expandSpace(const ParameterSpace& paramSpace, const parameterInstanceMap_t& prefix,
+		const std::function<void(parameterInstanceMap_t&)>& callback)
+	{
+		std::vector<const ParametersVec*> sequences;
+		std::vector<const std::string*> keyOrder;
+		sequences.reserve(paramSpace.parameters.size());
+		keyOrder.reserve(paramSpace.parameters.size());
+		for (auto& param : paramSpace.parameters)
+		{
+			if (prefix.count(param.first))
+			{
+				throw std::invalid_argument("Parameter " + param.first + " is defined more than once in the parameter space.");
+			}
+			keyOrder.push_back(&param.first);
+			sequences.push_back(&param.second);
+		}
+
+		auto expandCombination = [&](const std::vector<std::size_t>& indices)
+		{
+			parameterInstanceMap_t paramInstance = prefix;
+			for (std::size_t i = 0; i < indices.size(); ++i)
 			{
-				paramInstance[*key] = param;
-				key = (key == keyOrder.begin()) ? std::prev(keyOrder.end()) : std::prev(key);
+				paramInstance.emplace(*keyOrder[i], (*sequences[i])[indices[i]]);
 			}
-			// Remove paramter instance values that are irrelevant to the combination
-			for (auto& dontCare : dontCares)
+			// Sub-spaces owned by the values of this combination (or of its ancestors)
+			std::vector<const ParameterSpace*> subSpaces;
+			for (auto& [parentName, branches] : paramSpace.branches)
 			{
-				const std::string& dontCareKey = dontCare.first;
-				if (!paramInstance.count(dontCareKey))
+				auto parent = paramInstance.find(parentName);
+				if (parent == paramInstance.end())
 				{
 					continue;
 				}
-				Parameter dontCareVal = paramInstance[dontCareKey];
-				// Accesing dontCare.second[dontCareVal] results in an increment in the size of the dontCare[dontCareVal].
-				// This is problematic for total don't cares.
-				// Check size first and only access it if size is larger or equal to one.
-				if (dontCare.second.count(dontCareVal))
+				for (auto& branch : branches)
 				{
-					for (auto& paramName : dontCare.second[dontCareVal])
+					if (branch.value == parent->second)
 					{
-						paramInstance.erase(paramName);
+						subSpaces.push_back(&branch.space);
 					}
 				}
-				// Total don't care
-				if (!dontCare.second.size())
+			}
+			if (subSpaces.empty())
+			{
+				callback(paramInstance);
+				return;
+			}
+			expandSubSpaces(subSpaces, 0, paramInstance, callback);
+		};
+
+		// A space without parameters of its own only contributes its branches
+		if (sequences.empty())
+		{
+			expandCombination({});
+		}
+		else
+		{
+			forEachCombination(sequences, expandCombination);
+		}
+	}
+
+	void ParameterCombinator::expandSubSpaces(const std::vector<const ParameterSpace*>& subSpaces, std::size_t index,
+		const parameterInstanceMap_t& prefix, const std::function<void(parameterInstanceMap_t&)>& callback)
+	{
+		if (index == subSpaces.size())
+		{
+			parameterInstanceMap_t paramInstance = prefix;
+			callback(paramInstance);
+			return;
+		}
+		expandSpace(*subSpaces[index], prefix, [&](parameterInstanceMap_t& paramInstance)
+		{
+			expandSubSpaces(subSpaces, index + 1, paramInstance, callback);
+		});
+	}
+
+	std::shared_ptr<ParameterInstanceStorage> ParameterCombinator::beginCombine(const dontCares_t& dontCares, const CombineOptions& options)
+	{
+		// Instances are stripped of their don't care parameters before they are inserted, so the set orders them
+		// without the rules
+		ParameterInstanceSetCompare cmp;
+		if (options.stats)
+		{
+			*options.stats = CombineStats{};
+			cmp.callCounter_ = std::make_shared<std::atomic<std::uint64_t>>(0);
+		}
+		auto storage = std::make_shared<ParameterInstanceStorage>(storageMode_, cmp, compileRules(dontCares));
+		if (options.countMultiplicity)
+		{
+			storage->enableMultiplicities();
+		}
+		return storage;
+	}
+
+	void ParameterCombinator::publish(std::shared_ptr<const ParameterInstanceStorage> storage)
+	{
+		std::atomic_store(&storage_, std::move(storage));
+	}
+
+	std::shared_ptr<const ParameterInstanceStorage> ParameterCombinator::snapshot() const
+	{
+		return std::atomic_load(&storage_);
+	}
+
+	void ParameterCombinator::insertInstance(ParameterInstanceStorage& storage, parameterInstanceMap_t& paramInstance,
+		const CompiledDontCares& rules, const CombineOptions& options)
+	{
+		std::chrono::steady_clock::time_point dontCareStart;
+		std::vector<std::uint32_t> appliedRules;
+		if (options.stats)
+		{
+			dontCareStart = std::chrono::steady_clock::now();
+		}
+
+		// Remove paramter instance values that are irrelevant to the combination
+		rules.removeDisabledParameters(paramInstance, options.stats ? &appliedRules : nullptr);
+
+		std::chrono::nanoseconds dontCareTime{};
+		if (options.stats)
+		{
+			dontCareTime = std::chrono::steady_clock::now() - dontCareStart;
+		}
+		storeInstance(storage, std::move(paramInstance), rules, appliedRules, dontCareTime, options);
+	}
+
+	void ParameterCombinator::storeInstance(ParameterInstanceStorage& storage, parameterInstanceMap_t&& paramInstance,
+		const CompiledDontCares& rules,
+		const std::vector<std::uint32_t>& appliedRules, std::chrono::nanoseconds dontCareTime, const CombineOptions& options)
+	{
+		CombineStats* stats = options.stats;
+		if (!stats)
+		{
+			auto [inserted, isNew] = storage.set().insert(std::move(paramInstance));
+			if (options.countMultiplicity)
+			{
+				storage.addRawCombination(*inserted);
+			}
+			if (isNew && options.onNewCombination)
+			{
+				options.onNewCombination(*inserted);
+			}
+			return;
+		}
+
+		++stats->rawCombinations;
+		auto insertionStart = std::chrono::steady_clock::now();
+		auto [insertedInstance, inserted] = storage.set().insert(std::move(paramInstance));
+		auto insertionEnd = std::chrono::steady_clock::now();
+		if (options.countMultiplicity)
+		{
+			storage.addRawCombination(*insertedInstance);
+		}
+		stats->dontCareTime += dontCareTime;
+		stats->insertionTime += insertionEnd - insertionStart;
+
+		if (inserted && options.onNewCombination)
+		{
+			options.onNewCombination(*insertedInstance);
+		}
+
+		if (!inserted)
+		{
+			for (auto rule : appliedRules)
+			{
+				++stats->duplicatesPerRule[rules.label(rule)];
+			}
+		}
+		if (options.bytesInUse)
+		{
+			stats->peakBytes = std::max(stats->peakBytes, options.bytesInUse());
+		}
+		else if (storage.storageMode() == StorageMode::Arena)
+		{
+			stats->peakBytes = std::max(stats->peakBytes, storage.bytesInUse());
+		}
+	}
+
+	void ParameterCombinator::finishCombine(std::shared_ptr<ParameterInstanceStorage> storage, const CombineOptions& options,
+		std::chrono::steady_clock::time_point start)
+	{
+		CombineStats* stats = options.stats;
+		if (stats)
+		{
+			stats->distinctCombinations = storage->set().size();
+			stats->duplicatesCollapsed = stats->rawCombinations - stats->distinctCombinations;
+			stats->comparatorCalls = storage->set().key_comp().callCounter_->load();
+			// Lookups in the published set should not pay for counting
+			ParameterInstanceSetCompare cmp = storage->set().key_comp();
+			cmp.callCounter_ = nullptr;
+			storage->replaceCompare(cmp);
+			// Everything that is not don't care handling or insertion is spent generating the product
+			auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			stats->productTime = total - stats->dontCareTime - stats->insertionTime;
+		}
+		if (options.buildIndex)
+		{
+			storage->buildIndex();
+		}
+		publish(std::move(storage));
+	}
+
+	std::size_t ParameterCombinator::combineAndEvaluate(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+		const evaluator_t& evaluator, const PipelineOptions& options)
+	{
+		// Owned here so the instances handed to the evaluators outlive them even if generation is aborted
+		auto start = std::chrono::steady_clock::now();
+		auto storage = beginCombine(dontCares, CombineOptions{});
+		std::size_t evaluations = runPipeline([&](const CombineOptions& combineOptions)
+		{
+			generate(*storage, paramCombs, dontCares, combineOptions);
+		}, evaluator, options);
+		// Only reached when no evaluator failed, so a failed pipeline publishes nothing
+		finishCombine(storage, CombineOptions{}, start);
+		return evaluations;
+	}
+
+	std::size_t ParameterCombinator::combineAndEvaluate(const ParameterSpace& paramSpace, const dontCares_t& dontCares,
+		const evaluator_t& evaluator, const PipelineOptions& options)
+	{
+		// Owned here so the instances handed to the evaluators outlive them even if generation is aborted
+		auto start = std::chrono::steady_clock::now();
+		auto storage = beginCombine(dontCares, CombineOptions{});
+		std::size_t evaluations = runPipeline([&](const CombineOptions& combineOptions)
+		{
+			generate(*storage, paramSpace, dontCares, combineOptions);
+		}, evaluator, options);
+		// Only reached when no evaluator failed, so a failed pipeline publishes nothing
+		finishCombine(storage, CombineOptions{}, start);
+		return evaluations;
+	}
+
+	namespace
+	{
+		// Waits without holding a core forever: spin briefly, then yield, then sleep
+		void backoff(unsigned& attempt)
+		{
+			if (attempt >= 128)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			else if (attempt >= 64)
+			{
+				std::this_thread::yield();
+			}
+			++attempt;
+		}
+
+		struct PipelineAborted {};
+	}
+
+	std::size_t ParameterCombinator::runPipeline(const std::function<void(const CombineOptions&)>& generate,
+		const evaluator_t& evaluator, const PipelineOptions& options)
+	{
+		// Combinations are nodes of the result set, which never move while it grows, so only pointers are queued
+		BoundedQueue<const parameterInstanceMap_t*> queue(options.queueCapacity);
+		std::atomic<bool> generationDone{ false };
+		std::atomic<bool> failed{ false };
+		std::atomic<std::size_t> evaluated{ 0 };
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		auto fail = [&](std::exception_ptr exception)
+		{
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!error)
+			{
+				error = exception;
+			}
+			failed = true;
+		};
+
+		auto worker = [&]()
+		{
+			unsigned attempt = 0;
+			while (!failed)
+			{
+				const parameterInstanceMap_t* paramInstance = nullptr;
+				if (!queue.tryPop(paramInstance))
 				{
-					paramInstance.erase(dontCareKey);
+					if (!generationDone.load(std::memory_order_acquire))
+					{
+						backoff(attempt);
+						continue;
+					}
+					// The producer finishes pushing before raising the flag, so an empty queue after it is final
+					if (!queue.tryPop(paramInstance))
+					{
+						return;
+					}
+				}
+				attempt = 0;
+				try
+				{
+					evaluator(*paramInstance);
+					++evaluated;
+				}
+				catch (...)
+				{
+					fail(std::current_exception());
 				}
 			}
-			parameterInstanceSet_->insert(paramInstance);
+		};
+
+		std::size_t workerCount = options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::thread> workers;
+		for (std::size_t i = 0; i < workerCount; ++i)
+		{
+			workers.emplace_back(worker);
+		}
+
+		CombineOptions combineOptions;
+		combineOptions.onNewCombination = [&](const parameterInstanceMap_t& paramInstance)
+		{
+			// Backpressure: generation waits while the evaluators are behind. A failed evaluation stops generation
+			// before the next push, whether or not the queue has room.
+			unsigned attempt = 0;
+			while (true)
+			{
+				if (failed)
+				{
+					throw PipelineAborted{};
+				}
+				if (queue.tryPush(&paramInstance))
+				{
+					break;
+				}
+				backoff(attempt);
+			}
+		};
+		try
+		{
+			generate(combineOptions);
+		}
+		catch (const PipelineAborted&)
+		{
+		}
+		catch (...)
+		{
+			fail(std::current_exception());
+		}
+		generationDone.store(true, std::memory_order_release);
+
+		for (auto& thread : workers)
+		{
+			thread.join();
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+		return evaluated;
+	}
+
+	void CombineStats::exportCounters(const counterSink_t& sink) const
+	{
+		sink("rawCombinations",      static_cast<double>(rawCombinations));
+		sink("distinctCombinations", static_cast<double>(distinctCombinations));
+		sink("duplicatesCollapsed",  static_cast<double>(duplicatesCollapsed));
+		sink("comparatorCalls",      static_cast<double>(comparatorCalls));
+		sink("productTimeNs",        static_cast<double>(productTime.count()));
+		sink("dontCareTimeNs",       static_cast<double>(dontCareTime.count()));
+		sink("insertionTimeNs",      static_cast<double>(insertionTime.count()));
+		sink("peakBytes",            static_cast<double>(peakBytes));
+		for (auto& [rule, duplicates] : duplicatesPerRule)
+		{
+			sink("duplicatesPerRule." + rule, static_cast<double>(duplicates));
 		}
 	}
 
 	ParameterCombinator::ParameterCombinator()
+		: ParameterCombinator(StorageMode::Heap)
+	{
+	}
+
+	ParameterCombinator::ParameterCombinator(StorageMode storageMode)
+		: storageMode_(storageMode)
+		, storage_(std::make_shared<ParameterInstanceStorage>(storageMode))
 	{
-		ParameterInstanceSetCompare cmp(dontCares_t{});
-		parameterInstanceSet_ = std::make_shared<parameterInstanceSet_t>(cmp);
 	}
 
 	ParameterCombinator::ParameterCombinator(const ParameterCombinator& other)
+		: storageMode_(other.storageMode_)
+		, storage_(other.snapshot())
 	{
-		parameterInstanceSet_ = other.parameterInstanceSet_;
 	}
 
 	ParameterCombinator& ParameterCombinator::operator=(const ParameterCombinator& other)
 	{
-		parameterInstanceSet_ = other.parameterInstanceSet_;
+		storageMode_ = other.storageMode_;
+		publish(other.snapshot());
 		return *this;
 	}
 
 	void ParameterCombinator::clearCombinations()
 	{
-		parameterInstanceSet_.get()->clear();
+		auto storage = snapshot();
+		publish(std::make_shared<ParameterInstanceStorage>(storageMode_, storage->set().key_comp(), storage->rules()));
 	}
 
-	const parameterInstanceSet_t* ParameterCombinator::getParameterInstanceSet() const
+	parameterInstanceSet_t ParameterCombinator::extract()
 	{
-		return parameterInstanceSet_.get();
+		auto storage = snapshot();
+		clearCombinations();
+		// Once the empty set is published nobody can take another snapshot of 'storage', so a use count of one means
+		// the result set can be moved out
+		if (storage->storageMode() == StorageMode::Heap && storage.use_count() == 1)
+		{
+			return std::move(const_cast<ParameterInstanceStorage&>(*storage).set());
+		}
+		parameterInstanceSet_t paramSet(storage->set().key_comp(), std::pmr::get_default_resource());
+		for (auto& paramInstance : storage->set())
+		{
+			paramSet.emplace_hint(paramSet.end(), paramInstance);
+		}
+		return paramSet;
+	}
+
+	StorageMode ParameterCombinator::storageMode() const
+	{
+		return storageMode_;
+	}
+
+	std::shared_ptr<const parameterInstanceSet_t> ParameterCombinator::getParameterInstanceSet() const
+	{
+		auto storage = snapshot();
+		const parameterInstanceSet_t* paramSet = &storage->set();
+		return std::shared_ptr<const parameterInstanceSet_t>(std::move(storage), paramSet);
+	}
+
+	std::uint64_t ParameterCombinator::multiplicity(const parameterInstanceMap_t& paramInstance) const
+	{
+		auto storage = snapshot();
+		if (!storage->hasMultiplicities())
+		{
+			throw std::invalid_argument("Multiplicities are only recorded by combine() with CombineOptions::countMultiplicity.");
+		}
+		return storage->multiplicity(paramInstance);
+	}
+
+	std::shared_ptr<const ParameterIndex> ParameterCombinator::getParameterIndex() const
+	{
+		auto storage = snapshot();
+		const ParameterIndex* index = storage->index();
+		if (!index)
+		{
+			return nullptr;
+		}
+		return std::shared_ptr<const ParameterIndex>(std::move(storage), index);
+	}
+
+	bool ParameterCombinator::contains(const parameterInstanceMap_t& paramInstance) const
+	{
+		return snapshot()->find(paramInstance) != nullptr;
 	}
 
 	void ParameterCombinator::addCombinations(ParameterCombinator& paramCombinator1, ParameterCombinator& paramCombinator2, const dontCares_t& dontCares)
 	{
-		const parameterInstanceSet_t* paramSet1 = paramCombinator1.getParameterInstanceSet();
-		const parameterInstanceSet_t* paramSet2 = paramCombinator2.getParameterInstanceSet();
+		// Either input may be this combinator. Holding the snapshots keeps them alive until the sum is published.
+		auto paramSet1 = paramCombinator1.getParameterInstanceSet();
+		auto paramSet2 = paramCombinator2.getParameterInstanceSet();
 
-		ParameterInstanceSetCompare cmp(dontCares);
-		parameterInstanceSet_t sumParamSet(cmp);
+		// Stored instances are kept free of don't care parameters, as combine() does
+		auto rules = compileRules(dontCares);
+		auto storage = std::make_shared<ParameterInstanceStorage>(storageMode_, ParameterInstanceSetCompare{}, rules);
+		parameterInstanceSet_t& sumParamSet = storage->set();
 
-		for (auto& paramSet : { *paramSet1, *paramSet2 })
+		for (auto* paramSet : { paramSet1.get(), paramSet2.get() })
 		{
-			for (auto& paramInstance : paramSet)
+			for (auto& paramInstance : *paramSet)
 			{
-				sumParamSet.insert(paramInstance);
+				if (!rules)
+				{
+					sumParamSet.insert(paramInstance);
+					continue;
+				}
+				parameterInstanceMap_t sumInstance = paramInstance;
+				rules->removeDisabledParameters(sumInstance);
+				sumParamSet.insert(std::move(sumInstance));
 			}
 		}
-		*parameterInstanceSet_ = std::move(sumParamSet);
+		publish(std::move(storage));
 	}
+
+	void ParameterCombinator::forEachBatch(std::size_t batchSize, const std::function<void(const ParameterBatch&)>& callback) const
+	{
+		if (!batchSize)
+		{
+			throw std::invalid_argument("Batch size must be larger than zero.");
+		}
+		ParameterBatch batch;
+		std::vector<const parameterInstanceMap_t*> instances;
+		instances.reserve(batchSize);
+		// The snapshot keeps the instances alive even if this combinator is recombined meanwhile
+		auto storage = snapshot();
+		for (auto& paramInstance : storage->set())
+		{
+			instances.push_back(&paramInstance);
+			if (instances.size() == batchSize)
+			{
+				batch.assign(instances);
+				callback(batch);
+				instances.clear();
+			}
+		}
+		if (!instances.empty())
+		{
+			batch.assign(instances);
+			callback(batch);
+		}
+	}
+
+	std::uint64_t ParameterCombinator::combinationId(const parameterInstanceMap_t& paramInstance)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : generateCombinationName(paramInstance))
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
 	std::string ParameterCombinator::generateCombinationName(const parameterInstanceMap_t& paramInstance)
 	{
 		std::string combinationName;
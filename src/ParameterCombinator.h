@@ -1,27 +1,167 @@
 #pragma once
 #include "Parameters.h"
+#include "CompiledDontCares.h"
+#include "ParameterStorage.h"
+#include "ParameterBatch.h"
+#include "BoundedQueue.h"
+#include "ValueDictionary.h"
 #include <memory>
+#include <chrono>
+#include <cstdint>
 
 namespace parameterCombinator
 {
+	using counterSink_t = std::function<void(const std::string& name, double value)>;
+
+	// What happened inside a combine() call
+	struct CombineStats
+	{
+		// Combinations generated before removing don't cares and duplicates
+		std::uint64_t rawCombinations = 0;
+		// Combinations in the resulting set
+		std::uint64_t distinctCombinations = 0;
+		std::uint64_t duplicatesCollapsed = 0;
+		// Duplicates collapsed per don't care rule, keyed "parameter=value" ("parameter" for total don't cares).
+		// A duplicate is counted for every rule that removed parameters from it.
+		std::map<std::string, std::uint64_t> duplicatesPerRule;
+		std::uint64_t comparatorCalls = 0;
+		std::chrono::nanoseconds productTime{ 0 };
+		std::chrono::nanoseconds dontCareTime{ 0 };
+		std::chrono::nanoseconds insertionTime{ 0 };
+		// Highest value reported by CombineOptions::bytesInUse during the call. 0 when no probe is given.
+		std::size_t peakBytes = 0;
+
+		// Calls 'sink' once per counter, e.g. to forward them to a metrics system
+		void exportCounters(const counterSink_t& sink) const;
+	};
+
+	// Symmetries of whatever evaluates the combinations. combine() then generates one representative of every group of
+	// combinations known to give the same result instead of all of them.
+	struct Symmetries
+	{
+		// Groups of parameters whose values can be swapped among them, e.g. the gains of identical channels. The
+		// parameters of a group must have the same values. Only combinations whose value indices do not decrease
+		// along the group, in name order, are generated: n values over k parameters give C(n + k - 1, k) combinations
+		// instead of n^k.
+		std::vector<std::vector<std::string>> interchangeable;
+		// Per parameter, groups of values giving the same result. Only the first value of every group is combined,
+		// the others are dropped outright. This is not a permutation of values that maps combinations onto each other:
+		// every combination holding a later value of a group is assumed to be redundant on its own.
+		std::map<std::string, std::vector<std::vector<Parameter>>> collapsedValues;
+
+		bool empty() const;
+	};
+
+	struct CombineOptions
+	{
+		// Filled in by combine() when set
+		CombineStats* stats = nullptr;
+		// Returns the number of bytes currently allocated (e.g. from a custom allocator or malloc statistics).
+		// Sampled after every combination to compute CombineStats::peakBytes.
+		std::function<std::size_t()> bytesInUse;
+		// Called with every distinct combination as soon as it is inserted, while combine() is still running.
+		// The reference stays valid as long as the result set it belongs to (see getParameterInstanceSet()).
+		std::function<void(const parameterInstanceMap_t&)> onNewCombination;
+		// Builds a ParameterIndex over the result set before it is published (see getParameterIndex())
+		bool buildIndex = false;
+		// Counts the raw combinations collapsed into every distinct combination (see multiplicity())
+		bool countMultiplicity = false;
+		// Combinations skipped as symmetric are not generated at all, so they are not counted as raw combinations.
+		// The don't cares must treat the parameters of a group alike. Only supported for parameterCombinations_t.
+		Symmetries symmetries;
+	};
+
+	struct PipelineOptions
+	{
+		// Number of evaluator threads. 0 uses one per hardware thread.
+		std::size_t workers = 0;
+		// Combinations generated but not yet evaluated. Generation pauses when the queue is full.
+		std::size_t queueCapacity = 1024;
+	};
+
 	class ParameterCombinator
 	{
 	public:
 
 		ParameterCombinator();
+		explicit ParameterCombinator(StorageMode storageMode);
 		ParameterCombinator(const ParameterCombinator& other);
 		ParameterCombinator& operator=(const ParameterCombinator& other);
-		const parameterInstanceSet_t* getParameterInstanceSet() const;
-		void combine(parameterCombinations_t& paramCombs, dontCares_t& dontCares);
+		// Result set of the last combine() as an immutable, reference counted snapshot. combine(), clearCombinations()
+		// and addCombinations() build a new set and publish it atomically, so a snapshot stays valid and can be
+		// iterated without locks while the combinator is recombined. Only one thread may modify a combinator at a time.
+		std::shared_ptr<const parameterInstanceSet_t> getParameterInstanceSet() const;
+		// Bitmap index of the current result set if it was combined with CombineOptions::buildIndex, else null.
+		// Like a snapshot it keeps its result set alive.
+		std::shared_ptr<const ParameterIndex> getParameterIndex() const;
+		// Number of raw Cartesian combinations that don't cares and duplicate values collapsed into 'paramInstance'.
+		// 0 if it is not in the result set. Throws unless the result set was combined with
+		// CombineOptions::countMultiplicity. FanOut lists the raw combinations themselves.
+		std::uint64_t multiplicity(const parameterInstanceMap_t& paramInstance) const;
+		// Whether the result set holds 'paramInstance'. Its don't care parameters are removed first, so it may still
+		// hold them. The result set itself compares its stripped instances without the rules.
+		bool contains(const parameterInstanceMap_t& paramInstance) const;
+		void combine(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares, const CombineOptions& options = CombineOptions{});
+		void combine(const ParameterSpace& paramSpace, const dontCares_t& dontCares, const CombineOptions& options = CombineOptions{});
+		using evaluator_t = std::function<void(const parameterInstanceMap_t&)>;
+		// Combines on the calling thread while 'options.workers' threads evaluate each distinct combination as soon as
+		// it is generated. The result set is available afterwards as with combine(). Returns the number of evaluations.
+		// The first exception thrown by the evaluator stops the pipeline and is rethrown, and no result set is published.
+		std::size_t combineAndEvaluate(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+			const evaluator_t& evaluator, const PipelineOptions& options = PipelineOptions{});
+		std::size_t combineAndEvaluate(const ParameterSpace& paramSpace, const dontCares_t& dontCares,
+			const evaluator_t& evaluator, const PipelineOptions& options = PipelineOptions{});
 		void clearCombinations();
+		// Takes the result set out of the combinator, leaving it empty. The set is moved when nothing else shares it
+		// (no snapshots, copies or index users) and copied onto the heap otherwise, always in Arena mode.
+		parameterInstanceSet_t extract();
+		StorageMode storageMode() const;
 		void addCombinations(ParameterCombinator& paramCombinator1, ParameterCombinator& paramCombinator2, const dontCares_t& dontCares);
 		static std::string generateCombinationName(const parameterInstanceMap_t& paramInstance);
+		// 64 bit FNV-1a hash of generateCombinationName(). Stable across runs and platforms, so it can identify a
+		// combination in files.
+		static std::uint64_t combinationId(const parameterInstanceMap_t& paramInstance);
+		// Calls 'callback' with consecutive blocks of up to 'batchSize' combinations in structure-of-arrays form
+		void forEachBatch(std::size_t batchSize, const std::function<void(const ParameterBatch&)>& callback) const;
+		// Calls 'callback' with the value indices of every element of the Cartesian product of 'sequences'
+		static void forEachCombination(const std::vector<const ParametersVec*>& sequences,
+			const std::function<void(const std::vector<std::size_t>&)>& callback);
 	private:
-		std::vector<std::vector<Parameter>> CartesianProduct(std::vector<std::vector<Parameter>>& sequences);
-		void CartesianRecurse(std::vector<std::vector<Parameter>>& accum, std::vector<Parameter> stack,
-			std::vector<std::vector<Parameter>> sequences, int64_t index);
+		// Odometer over 'sizes' in which the index of digit i never drops below the index of the earlier digit
+		// floors[i] (npos for none)
+		static void forEachIndexTuple(const std::vector<std::size_t>& sizes, const std::vector<std::size_t>& floors,
+			const std::function<void(const std::vector<std::size_t>&)>& callback);
+		// Calls 'callback' with every combination of 'paramSpace' appended to 'prefix', expanding sub-spaces
+		// only under the parameter values that own them
+		static void expandSpace(const ParameterSpace& paramSpace, const parameterInstanceMap_t& prefix,
+			const std::function<void(parameterInstanceMap_t&)>& callback);
+		static void expandSubSpaces(const std::vector<const ParameterSpace*>& subSpaces, std::size_t index,
+			const parameterInstanceMap_t& prefix, const std::function<void(parameterInstanceMap_t&)>& callback);
+		// Empty result set for a new combine() call. It is filled off to the side and published by finishCombine().
+		std::shared_ptr<ParameterInstanceStorage> beginCombine(const dontCares_t& dontCares, const CombineOptions& options);
+		// Inserts every combination into 'storage'
+		void generate(ParameterInstanceStorage& storage, const parameterCombinations_t& paramCombs,
+			const dontCares_t& dontCares, const CombineOptions& options);
+		void generate(ParameterInstanceStorage& storage, const ParameterSpace& paramSpace,
+			const dontCares_t& dontCares, const CombineOptions& options);
+		// Removes the parameters made irrelevant by 'rules' and moves the instance into 'storage'
+		void insertInstance(ParameterInstanceStorage& storage, parameterInstanceMap_t& paramInstance,
+			const CompiledDontCares& rules, const CombineOptions& options);
+		// Moves an instance the rules were already applied to into 'storage' and updates the statistics. In Arena
+		// mode the instance is copied into the arena, so that duplicates never take arena memory.
+		void storeInstance(ParameterInstanceStorage& storage, parameterInstanceMap_t&& paramInstance,
+			const CompiledDontCares& rules, const std::vector<std::uint32_t>& appliedRules,
+			std::chrono::nanoseconds dontCareTime, const CombineOptions& options);
+		std::size_t runPipeline(const std::function<void(const CombineOptions&)>& generate,
+			const evaluator_t& evaluator, const PipelineOptions& options);
+		void finishCombine(std::shared_ptr<ParameterInstanceStorage> storage, const CombineOptions& options,
+			std::chrono::steady_clock::time_point start);
+		void publish(std::shared_ptr<const ParameterInstanceStorage> storage);
+		std::shared_ptr<const ParameterInstanceStorage> snapshot() const;
 
-		std::shared_ptr<parameterInstanceSet_t> parameterInstanceSet_;
+		StorageMode storageMode_;
+		// Only accessed through publish() and snapshot(), which load and store it atomically
+		std::shared_ptr<const ParameterInstanceStorage> storage_;
 
 	};
 
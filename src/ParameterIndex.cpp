@@ -0,0 +1,165 @@
+#include "ParameterIndex.h"
+#include <limits>
+#include <stdexcept>
+
+namespace parameterCombinator
+{
+	ParameterIndex::ParameterIndex(const parameterInstanceSet_t& paramSet)
+	{
+		if (paramSet.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::invalid_argument("ParameterIndex supports at most 2^32 - 1 combinations.");
+		}
+		rows_.reserve(paramSet.size());
+
+		// Neighbouring rows of the sorted set mostly share values, so the bitmap of the last value seen per
+		// column is checked before looking the value up
+		struct ColumnBuilder
+		{
+			Column* column = nullptr;
+			const Parameter* lastValue = nullptr;
+			RoaringBitmap* lastBitmap = nullptr;
+		};
+		std::map<std::string, ColumnBuilder> builders;
+
+		std::uint32_t row = 0;
+		for (auto& paramInstance : paramSet)
+		{
+			rows_.push_back(&paramInstance);
+			for (auto& [name, value] : paramInstance)
+			{
+				ColumnBuilder& builder = builders[name];
+				if (!builder.column)
+				{
+					builder.column = &columns_[name];
+				}
+				if (!builder.lastValue || *builder.lastValue != value)
+				{
+					auto entry = builder.column->values.try_emplace(value).first;
+					builder.lastValue = &entry->first;
+					builder.lastBitmap = &entry->second;
+				}
+				builder.lastBitmap->add(row);
+				builder.column->present.add(row);
+			}
+			++row;
+		}
+
+		all_ = RoaringBitmap::range(0, row);
+		for (auto& [name, column] : columns_)
+		{
+			column.absent = all_ - column.present;
+		}
+	}
+
+	std::size_t ParameterIndex::rows() const
+	{
+		return rows_.size();
+	}
+
+	const RoaringBitmap& ParameterIndex::all() const
+	{
+		return all_;
+	}
+
+	const ParameterIndex::Column* ParameterIndex::findColumn(const std::string& name) const
+	{
+		auto column = columns_.find(name);
+		return column == columns_.end() ? nullptr : &column->second;
+	}
+
+	const RoaringBitmap& ParameterIndex::equals(const std::string& name, const Parameter& value) const
+	{
+		const Column* column = findColumn(name);
+		if (!column)
+		{
+			return empty_;
+		}
+		auto entry = column->values.find(value);
+		return entry == column->values.end() ? empty_ : entry->second;
+	}
+
+	RoaringBitmap ParameterIndex::anyOf(const std::string& name, const std::vector<Parameter>& values) const
+	{
+		RoaringBitmap result;
+		for (auto& value : values)
+		{
+			result |= equals(name, value);
+		}
+		return result;
+	}
+
+	RoaringBitmap ParameterIndex::notEquals(const std::string& name, const Parameter& value) const
+	{
+		return present(name) - equals(name, value);
+	}
+
+	const RoaringBitmap& ParameterIndex::present(const std::string& name) const
+	{
+		const Column* column = findColumn(name);
+		return column ? column->present : empty_;
+	}
+
+	const RoaringBitmap& ParameterIndex::absent(const std::string& name) const
+	{
+		const Column* column = findColumn(name);
+		return column ? column->absent : all_;
+	}
+
+	std::vector<std::string> ParameterIndex::names() const
+	{
+		std::vector<std::string> names;
+		names.reserve(columns_.size());
+		for (auto& [name, column] : columns_)
+		{
+			names.push_back(name);
+		}
+		return names;
+	}
+
+	std::vector<Parameter> ParameterIndex::values(const std::string& name) const
+	{
+		std::vector<Parameter> values;
+		if (const Column* column = findColumn(name))
+		{
+			values.reserve(column->values.size());
+			for (auto& [value, bitmap] : column->values)
+			{
+				values.push_back(value);
+			}
+		}
+		return values;
+	}
+
+	const parameterInstanceMap_t& ParameterIndex::instance(std::uint32_t row) const
+	{
+		if (row >= rows_.size())
+		{
+			throw std::out_of_range("ParameterIndex row out of range.");
+		}
+		return *rows_[row];
+	}
+
+	std::vector<const parameterInstanceMap_t*> ParameterIndex::instances(const RoaringBitmap& rows) const
+	{
+		std::vector<const parameterInstanceMap_t*> result;
+		result.reserve(static_cast<std::size_t>(rows.cardinality()));
+		rows.forEach([&](std::uint32_t row) { result.push_back(&instance(row)); });
+		return result;
+	}
+
+	std::size_t ParameterIndex::bytes() const
+	{
+		std::size_t total = all_.bytes();
+		for (auto& [name, column] : columns_)
+		{
+			total += column.present.bytes() + column.absent.bytes();
+			for (auto& [value, bitmap] : column.values)
+			{
+				total += bitmap.bytes();
+			}
+		}
+		return total;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,54 @@
+#pragma once
+#include "Parameters.h"
+#include "RoaringBitmap.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace parameterCombinator
+{
+	// Secondary index over a result set: one bitmap per (parameter, value) and one per parameter for the rows where it
+	// is absent, e.g. because a don't care removed it. Rows are numbered in the iteration order of the set, so filters
+	// combine as bitmap AND (&), OR (|) and AND NOT (-) and are resolved to instances at the end.
+	class ParameterIndex
+	{
+	public:
+		// 'paramSet' must outlive the index and must not be modified while it is used
+		explicit ParameterIndex(const parameterInstanceSet_t& paramSet);
+
+		std::size_t rows() const;
+		const RoaringBitmap& all() const;
+		// Rows holding 'name' with 'value'
+		const RoaringBitmap& equals(const std::string& name, const Parameter& value) const;
+		// Rows holding 'name' with any of 'values'
+		RoaringBitmap anyOf(const std::string& name, const std::vector<Parameter>& values) const;
+		// Rows holding 'name' with a value other than 'value'. Rows without 'name' do not match.
+		RoaringBitmap notEquals(const std::string& name, const Parameter& value) const;
+		const RoaringBitmap& present(const std::string& name) const;
+		const RoaringBitmap& absent(const std::string& name) const;
+
+		// Indexed parameter names and the distinct values of one of them, in sorted order
+		std::vector<std::string> names() const;
+		std::vector<Parameter> values(const std::string& name) const;
+
+		const parameterInstanceMap_t& instance(std::uint32_t row) const;
+		std::vector<const parameterInstanceMap_t*> instances(const RoaringBitmap& rows) const;
+		// Memory held by the bitmaps
+		std::size_t bytes() const;
+
+	private:
+		struct Column
+		{
+			std::map<Parameter, RoaringBitmap> values;
+			RoaringBitmap present;
+			RoaringBitmap absent;
+		};
+		const Column* findColumn(const std::string& name) const;
+
+		std::vector<const parameterInstanceMap_t*> rows_;
+		std::map<std::string, Column> columns_;
+		RoaringBitmap all_;
+		RoaringBitmap empty_;
+	};
+
+} // Namespace parameterCombinator
@@ -0,0 +1,145 @@
+#include "ParameterStorage.h"
+#include <algorithm>
+
+namespace parameterCombinator
+{
+	// Size of the first arena block. Following blocks grow geometrically.
+	static constexpr std::size_t arenaInitialBlockSize = 64 * 1024;
+
+	CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+		: upstream_(upstream)
+	{
+	}
+
+	std::size_t CountingResource::bytesInUse() const
+	{
+		return bytesInUse_;
+	}
+
+	std::size_t CountingResource::peakBytesInUse() const
+	{
+		return peakBytesInUse_;
+	}
+
+	void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		void* ptr = upstream_->allocate(bytes, alignment);
+		bytesInUse_ += bytes;
+		peakBytesInUse_ = std::max(peakBytesInUse_, bytesInUse_);
+		return ptr;
+	}
+
+	void CountingResource::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+	{
+		upstream_->deallocate(ptr, bytes, alignment);
+		bytesInUse_ -= bytes;
+	}
+
+	bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+
+	ParameterInstanceStorage::ParameterInstanceStorage(StorageMode storageMode, const ParameterInstanceSetCompare& cmp,
+		std::shared_ptr<const CompiledDontCares> rules)
+		: storageMode_(storageMode)
+		, upstream_()
+		, arena_(storageMode == StorageMode::Arena
+			? std::make_unique<std::pmr::monotonic_buffer_resource>(arenaInitialBlockSize, &upstream_)
+			: nullptr)
+		, rules_(std::move(rules))
+		, set_(cmp,
+			arena_ ? static_cast<std::pmr::memory_resource*>(arena_.get()) : std::pmr::get_default_resource())
+	{
+	}
+
+	StorageMode ParameterInstanceStorage::storageMode() const
+	{
+		return storageMode_;
+	}
+
+	parameterInstanceSet_t& ParameterInstanceStorage::set()
+	{
+		return set_;
+	}
+
+	const parameterInstanceSet_t& ParameterInstanceStorage::set() const
+	{
+		return set_;
+	}
+
+	const std::shared_ptr<const CompiledDontCares>& ParameterInstanceStorage::rules() const
+	{
+		return rules_;
+	}
+
+	const parameterInstanceMap_t* ParameterInstanceStorage::find(const parameterInstanceMap_t& paramInstance) const
+	{
+		auto element = set_.end();
+		if (!rules_)
+		{
+			element = set_.find(paramInstance);
+		}
+		else
+		{
+			// The rules are applied once to the probe. Stored instances are already stripped, so the set compares
+			// them without looking at the rules.
+			parameterInstanceMap_t stripped = paramInstance;
+			rules_->removeDisabledParameters(stripped);
+			element = set_.find(stripped);
+		}
+		return element == set_.end() ? nullptr : &*element;
+	}
+
+	void ParameterInstanceStorage::replaceCompare(const ParameterInstanceSetCompare& cmp)
+	{
+		parameterInstanceSet_t relinked(cmp, set_.get_allocator());
+		while (!set_.empty())
+		{
+			relinked.insert(relinked.end(), set_.extract(set_.begin()));
+		}
+		set_.swap(relinked);
+	}
+
+	std::size_t ParameterInstanceStorage::bytesInUse() const
+	{
+		return upstream_.bytesInUse();
+	}
+
+	const ParameterIndex* ParameterInstanceStorage::index() const
+	{
+		return index_.get();
+	}
+
+	void ParameterInstanceStorage::buildIndex()
+	{
+		index_ = std::make_unique<const ParameterIndex>(set_);
+	}
+
+	void ParameterInstanceStorage::enableMultiplicities()
+	{
+		hasMultiplicities_ = true;
+	}
+
+	bool ParameterInstanceStorage::hasMultiplicities() const
+	{
+		return hasMultiplicities_;
+	}
+
+	void ParameterInstanceStorage::addRawCombination(const parameterInstanceMap_t& paramInstance)
+	{
+		++multiplicities_[&paramInstance];
+	}
+
+	std::uint64_t ParameterInstanceStorage::multiplicity(const parameterInstanceMap_t& paramInstance) const
+	{
+		const parameterInstanceMap_t* element = find(paramInstance);
+		if (!element)
+		{
+			return 0;
+		}
+		auto count = multiplicities_.find(element);
+		return count == multiplicities_.end() ? 0 : count->second;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,82 @@
+#pragma once
+#include "Parameters.h"
+#include "ParameterIndex.h"
+#include "CompiledDontCares.h"
+#include <memory>
+#include <unordered_map>
+#include <memory_resource>
+
+namespace parameterCombinator
+{
+	enum class StorageMode
+	{
+		// Every map node, set node and key string is allocated individually from the global heap
+		Heap,
+		// The result set is allocated from a monotonic arena. Destroying it frees a handful of large blocks
+		// instead of calling free once per node.
+		Arena
+	};
+
+	// memory_resource that forwards to an upstream resource and keeps track of the bytes it holds
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+		std::size_t bytesInUse() const;
+		std::size_t peakBytesInUse() const;
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		std::pmr::memory_resource* upstream_;
+		std::size_t bytesInUse_ = 0;
+		std::size_t peakBytesInUse_ = 0;
+	};
+
+	// Result set of a combination together with the memory it is allocated from
+	class ParameterInstanceStorage
+	{
+	public:
+		// 'rules' are the don't cares the stored instances were stripped of, null if there are none
+		explicit ParameterInstanceStorage(StorageMode storageMode, const ParameterInstanceSetCompare& cmp = ParameterInstanceSetCompare{},
+			std::shared_ptr<const CompiledDontCares> rules = nullptr);
+		ParameterInstanceStorage(const ParameterInstanceStorage&) = delete;
+		ParameterInstanceStorage& operator=(const ParameterInstanceStorage&) = delete;
+
+		StorageMode storageMode() const;
+		parameterInstanceSet_t& set();
+		const parameterInstanceSet_t& set() const;
+		const std::shared_ptr<const CompiledDontCares>& rules() const;
+		// Element of set() equal to 'paramInstance' once the rules removed its don't care parameters, or null
+		const parameterInstanceMap_t* find(const parameterInstanceMap_t& paramInstance) const;
+		// Re-links the elements into a set ordered by 'cmp', which must order them like the current comparator.
+		// Elements keep their addresses and nothing is allocated.
+		void replaceCompare(const ParameterInstanceSetCompare& cmp);
+		// Bytes taken from the heap by the arena. Always 0 in Heap mode.
+		std::size_t bytesInUse() const;
+		// Secondary index over set(), or null if none was built. Must be set before the storage is shared.
+		const ParameterIndex* index() const;
+		void buildIndex();
+		// Multiplicities are recorded once enabled, before the set is filled
+		void enableMultiplicities();
+		bool hasMultiplicities() const;
+		// Counts one more raw combination collapsed into 'paramInstance', which must be an element of set()
+		void addRawCombination(const parameterInstanceMap_t& paramInstance);
+		// Raw combinations counted for the element of set() equal to 'paramInstance', 0 when none were counted
+		std::uint64_t multiplicity(const parameterInstanceMap_t& paramInstance) const;
+
+	private:
+		StorageMode storageMode_;
+		CountingResource upstream_;
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+		std::shared_ptr<const CompiledDontCares> rules_;
+		// Declared last so it is destroyed before the arena it lives in
+		parameterInstanceSet_t set_;
+		std::unique_ptr<const ParameterIndex> index_;
+		bool hasMultiplicities_ = false;
+		// Keyed by the address of the set element
+		std::unordered_map<const parameterInstanceMap_t*, std::uint64_t> multiplicities_;
+	};
+
+} // Namespace parameterCombinator
@@ -1,4 +1,5 @@
 #include "Parameters.h"
+#include "CompiledDontCares.h"
 #include <iostream>
 
 namespace parameterCombinator
@@ -34,31 +35,57 @@ bool operator>(const ParameterBase& lhs, const ParameterBase& rhs) {
 	}
 }
 
+namespace
+{
+	bool sameDictionary(const ParameterBase& lhs, const ParameterBase& rhs)
+	{
+		return lhs.dictionary() && lhs.dictionary() == rhs.dictionary();
+	}
+	// Values of one ValueDictionary are compared by rank, without virtual calls. A dictionary holds every value
+	// once, so distinct values of one dictionary are never equal.
+	bool isEqual(const ParameterBase& lhs, const ParameterBase& rhs)
+	{
+		if (&lhs == &rhs)
+		{
+			return true;
+		}
+		return !sameDictionary(lhs, rhs) && lhs == rhs;
+	}
+	bool isLower(const ParameterBase& lhs, const ParameterBase& rhs)
+	{
+		if (sameDictionary(lhs, rhs))
+		{
+			return lhs.rank() < rhs.rank();
+		}
+		return lhs < rhs;
+	}
+}
+
 // Parameter operators
 
 bool operator==(const Parameter& lhs, const Parameter& rhs)
 {
-	return *lhs.param_ == *rhs.param_;
+	return isEqual(*lhs.param_, *rhs.param_);
 }
 bool operator!=(const Parameter& lhs, const Parameter& rhs)
 {
-	return !(*lhs.param_ == *rhs.param_);
+	return !isEqual(*lhs.param_, *rhs.param_);
 }
 bool operator<(const Parameter& lhs, const Parameter& rhs)
 {
-	return *lhs.param_ < *rhs.param_;
+	return isLower(*lhs.param_, *rhs.param_);
 }
 bool operator<=(const Parameter& lhs, const Parameter& rhs)
 {
-	return (*lhs.param_ < *rhs.param_) || (*lhs.param_ == *rhs.param_);
+	return !(rhs < lhs);
 }
 bool operator>(const Parameter& lhs, const Parameter& rhs)
 {
-	return *lhs.param_ > *rhs.param_;
+	return rhs < lhs;
 }
 bool operator>=(const Parameter& lhs, const Parameter& rhs)
 {
-	return (*lhs.param_ > *rhs.param_) || (*lhs.param_ == *rhs.param_);
+	return !(lhs < rhs);
 }
 
 // Function definitions
@@ -67,10 +94,49 @@ ParametersVec::ParametersVec()
 {
 }
 
+ParametersVec::ParametersVec(std::size_t size, generator_t generator)
+	: lazySize_(size), generator_(std::move(generator))
+{
+}
+
 ParametersVec::~ParametersVec()
 {
 }
 
+std::size_t ParametersVec::size() const
+{
+	return isLazy() ? lazySize_ : parametersVec_.size();
+}
+
+bool ParametersVec::isLazy() const
+{
+	return static_cast<bool>(generator_);
+}
+
+Parameter ParametersVec::operator[](std::size_t idx) const
+{
+	if (idx >= size())
+	{
+		throw std::out_of_range("ParametersVec index out of range.");
+	}
+	return isLazy() ? generator_(idx) : parametersVec_[idx];
+}
+
+void ParametersVec::materialize()
+{
+	if (!isLazy())
+	{
+		return;
+	}
+	parametersVec_.reserve(lazySize_);
+	for (std::size_t idx = 0; idx < lazySize_; ++idx)
+	{
+		parametersVec_.push_back(generator_(idx));
+	}
+	generator_ = nullptr;
+	lazySize_ = 0;
+}
+
 Parameter::Parameter()
 {
 }
@@ -79,4 +145,95 @@ Parameter::~Parameter()
 {
 }
 
+namespace
+{
+	// Walks the entries of an instance skipping the parameters disabled by don't cares
+	class PresentEntries
+	{
+	public:
+		PresentEntries(const parameterInstanceMap_t& paramInstance, const std::vector<std::string>& names, const ParameterMask& disabled)
+			: it_(paramInstance.begin()), end_(paramInstance.end()), names_(names), disabled_(disabled)
+		{
+			skipDisabled();
+		}
+		bool done() const
+		{
+			return it_ == end_;
+		}
+		const parameterInstanceMap_t::value_type& operator*() const
+		{
+			return *it_;
+		}
+		void next()
+		{
+			++it_;
+			skipDisabled();
+		}
+	private:
+		void skipDisabled()
+		{
+			// Both the instance and the rule names are sorted, so one forward pass finds every disabled entry
+			while (it_ != end_)
+			{
+				while (name_ < names_.size() && names_[name_] < it_->first)
+				{
+					++name_;
+				}
+				if (name_ < names_.size() && names_[name_] == it_->first && disabled_.test(name_))
+				{
+					++it_;
+					continue;
+				}
+				return;
+			}
+		}
+
+		parameterInstanceMap_t::const_iterator it_;
+		parameterInstanceMap_t::const_iterator end_;
+		const std::vector<std::string>& names_;
+		const ParameterMask& disabled_;
+		std::size_t name_ = 0;
+	};
+}
+
+ParameterInstanceSetCompare::ParameterInstanceSetCompare(const dontCares_t& dontCares)
+{
+	auto rules = std::make_shared<const CompiledDontCares>(dontCares);
+	if (!rules->empty())
+	{
+		rules_ = std::move(rules);
+	}
+}
+
+bool ParameterInstanceSetCompare::operator()(const parameterInstanceMap_t& a, const parameterInstanceMap_t& b) const
+{
+	if (callCounter_)
+	{
+		callCounter_->fetch_add(1, std::memory_order_relaxed);
+	}
+	if (!rules_)
+	{
+		return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+	}
+
+	ParameterMask disabledA(rules_->words());
+	ParameterMask disabledB(rules_->words());
+	rules_->disabledParameters(a, disabledA.data());
+	rules_->disabledParameters(b, disabledB.data());
+	PresentEntries lhs(a, rules_->names(), disabledA);
+	PresentEntries rhs(b, rules_->names(), disabledB);
+	for (; !lhs.done() && !rhs.done(); lhs.next(), rhs.next())
+	{
+		if (*lhs < *rhs)
+		{
+			return true;
+		}
+		if (*rhs < *lhs)
+		{
+			return false;
+		}
+	}
+	return lhs.done() && !rhs.done();
+}
+
 } // Namespace parameterCombinator
@@ -19,6 +19,10 @@
 #include <memory>
 #include <cstring>
 #include <cmath>
+#include <iterator>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
 
 namespace parameterCombinator
 {
@@ -45,12 +49,75 @@ namespace CHECK
 }
 
 
+// Contiguous column holding the values of one parameter for a block of combinations (see ParameterBatch)
+class ParameterColumnBase
+{
+public:
+	virtual ~ParameterColumnBase() {};
+	virtual const std::type_info& type() const = 0;
+};
+
+template<typename T>
+class ParameterColumn : public ParameterColumnBase
+{
+public:
+	// Empty column with room for 'rows' values. Rows are copy constructed in order by append(), so T does not
+	// need to be assignable.
+	explicit ParameterColumn(std::size_t rows)
+		: capacity_(rows), size_(0), data_(std::allocator<T>().allocate(rows))
+	{
+	}
+	~ParameterColumn()
+	{
+		std::destroy_n(data_, size_);
+		std::allocator<T>().deallocate(data_, capacity_);
+	}
+	ParameterColumn(const ParameterColumn&) = delete;
+	ParameterColumn& operator=(const ParameterColumn&) = delete;
+
+	const std::type_info& type() const override
+	{
+		return typeid(T);
+	}
+	const T* data() const
+	{
+		return data_;
+	}
+	void append(const T& value)
+	{
+		::new (static_cast<void*>(data_ + size_)) T(value);
+		++size_;
+	}
+private:
+	std::size_t capacity_;
+	std::size_t size_;
+	T* data_;
+};
+
+class ValueDictionary;
+
 class ParameterBase {
 
 public:
 
 	virtual ~ParameterBase() {};
 	virtual std::string toString() const = 0;
+	// Copy of this value, e.g. to intern it in a ValueDictionary
+	virtual std::shared_ptr<ParameterBase> clone() const = 0;
+	// Id of the ValueDictionary the value was interned in (0 if none) and its rank there. Values of one dictionary
+	// compare by rank.
+	std::uint64_t dictionary() const
+	{
+		return dictionary_;
+	}
+	std::uint32_t rank() const
+	{
+		return rank_;
+	}
+	// Empty column with room for 'rows' values of this type
+	virtual std::unique_ptr<ParameterColumnBase> makeColumn(std::size_t rows) const = 0;
+	// Appends a copy of this value to a column created by a parameter of the same type
+	virtual void appendToColumn(ParameterColumnBase& column) const = 0;
 
 protected:
 
@@ -61,6 +128,13 @@ protected:
 	virtual bool        isEqual(const ParameterBase& obj) const = 0;
 	virtual bool    isLowerThan(const ParameterBase& obj) const = 0;
 
+private:
+
+	friend class ValueDictionary;
+
+	std::uint64_t dictionary_ = 0;
+	std::uint32_t rank_ = 0;
+
 };
 
 bool operator==(const ParameterBase& lhs, const ParameterBase& rhs);
@@ -97,6 +171,8 @@ class ParameterDerived;
 class Parameter
 {
 private:
+	friend class ValueDictionary;
+
 	std::shared_ptr<const ParameterBase> param_;
 public:
 	Parameter();
@@ -183,10 +259,22 @@ public:
 			return std::to_string(getAddressOfVal(val_));
 		}
 	}
+	std::shared_ptr<ParameterBase> clone() const override
+	{
+		return std::make_shared<ParameterDerived>(*this);
+	}
+	std::unique_ptr<ParameterColumnBase> makeColumn(std::size_t rows) const override
+	{
+		return std::make_unique<ParameterColumn<T>>(rows);
+	}
+	void appendToColumn(ParameterColumnBase& column) const override
+	{
+		static_cast<ParameterColumn<T>&>(column).append(val_);
+	}
 protected:
 	virtual bool isEqual(const ParameterBase& obj) const override
 	{
-		auto v = static_cast<const ParameterDerived&>(obj);
+		auto& v = static_cast<const ParameterDerived&>(obj);
 		if constexpr (std::is_pointer<T>::value)
 		{
 			if constexpr (std::is_same<T, const char*>::value)
@@ -202,18 +290,60 @@ protected:
 	}
 	virtual bool isLowerThan(const ParameterBase& obj) const override
 	{
-		auto v = static_cast<const ParameterDerived&>(obj);
+		auto& v = static_cast<const ParameterDerived&>(obj);
 		if constexpr (std::is_pointer<T>::value)
 		{
+			if constexpr (std::is_same<T, const char*>::value)
+			{
+				return strcmp(val_, v.val_) < 0;
+			}
 			return *val_ < *v.val_;
 		}
 		return val_ < v.val_;
 	}
 };
 
+// List of values a parameter can take. Values are either stored explicitly or produced on demand
+// by a generator (ranges, linspace, logspace or a user function), in which case no memory is used per value.
 class ParametersVec
 {
 public:
+	using generator_t = std::function<Parameter(std::size_t)>;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type        = Parameter;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = void;
+		using reference         = Parameter;
+
+		const_iterator(const ParametersVec* parametersVec, std::size_t idx)
+			: parametersVec_(parametersVec), idx_(idx)
+		{}
+		Parameter operator*() const
+		{
+			return (*parametersVec_)[idx_];
+		}
+		const_iterator& operator++()
+		{
+			++idx_;
+			return *this;
+		}
+		bool operator==(const const_iterator& other) const
+		{
+			return parametersVec_ == other.parametersVec_ && idx_ == other.idx_;
+		}
+		bool operator!=(const const_iterator& other) const
+		{
+			return !(*this == other);
+		}
+	private:
+		const ParametersVec* parametersVec_;
+		std::size_t idx_;
+	};
+
 	ParametersVec();
 	~ParametersVec();
 	template<typename T>
@@ -224,34 +354,123 @@ public:
 			parametersVec_.emplace_back(val);
 		}
 	}
+	// Lazy list of 'size' values where the value at index i is generator(i)
+	ParametersVec(std::size_t size, generator_t generator);
+
+	// Values start, start + step, ... up to but not including stop
+	template<typename T>
+	static ParametersVec range(T start, T stop, T step = T(1))
+	{
+		static_assert(std::is_arithmetic<T>::value, "Error, range values must be arithmetic.");
+		if (step == T(0))
+		{
+			throw std::invalid_argument("Range step cannot be zero.");
+		}
+		bool ascending = step > T(0);
+		std::size_t size = 0;
+		if ((ascending && start < stop) || (!ascending && stop < start))
+		{
+			long double span = static_cast<long double>(stop) - static_cast<long double>(start);
+			size = static_cast<std::size_t>(std::ceil(span / static_cast<long double>(step)));
+		}
+		return ParametersVec(size, [start, step](std::size_t idx)
+			{
+				if constexpr (std::is_integral<T>::value)
+				{
+					// The offset is computed modulo 2^64, so it can not overflow a narrow T even where idx does not
+					// fit in T. The value itself always does.
+					using wide_t = unsigned long long;
+					return Parameter(static_cast<T>(static_cast<wide_t>(start) + static_cast<wide_t>(idx) * static_cast<wide_t>(step)));
+				}
+				else
+				{
+					return Parameter(static_cast<T>(start + static_cast<T>(idx) * step));
+				}
+			});
+	}
+	// 'num' evenly spaced values from start to stop, both included
+	template<typename T>
+	static ParametersVec linspace(T start, T stop, std::size_t num)
+	{
+		static_assert(std::is_floating_point<T>::value, "Error, linspace values must be floating point.");
+		return ParametersVec(num, [start, stop, num](std::size_t idx)
+			{
+				return Parameter(linspaceValue(start, stop, num, idx));
+			});
+	}
+	// 'num' values evenly spaced on a log scale from base^start to base^stop, both included
+	template<typename T>
+	static ParametersVec logspace(T start, T stop, std::size_t num, T base = T(10))
+	{
+		static_assert(std::is_floating_point<T>::value, "Error, logspace values must be floating point.");
+		return ParametersVec(num, [start, stop, num, base](std::size_t idx)
+			{
+				return Parameter(static_cast<T>(std::pow(base, linspaceValue(start, stop, num, idx))));
+			});
+	}
+
+	// Appending to a lazy list materializes its values first
 	template<typename T>
 	void push_back(T val)
 	{
+		materialize();
 		parametersVec_.push_back(val);
 	}
-	auto begin()
+	const_iterator begin() const
 	{
-		return parametersVec_.begin();
+		return const_iterator(this, 0);
 	}
-	auto end()
+	const_iterator end() const
 	{
-		return parametersVec_.end();
+		return const_iterator(this, size());
 	}
-	Parameter& operator[](int idx)
+	std::size_t size() const;
+	bool isLazy() const;
+	Parameter operator[](std::size_t idx) const;
+private:
+	template<typename T>
+	static T linspaceValue(T start, T stop, std::size_t num, std::size_t idx)
 	{
-		return parametersVec_[idx];
+		if (num < 2)
+		{
+			return start;
+		}
+		if (idx == num - 1)
+		{
+			return stop;
+		}
+		return start + (stop - start) * static_cast<T>(idx) / static_cast<T>(num - 1);
 	}
-private:
+	void materialize();
+
 	std::vector<Parameter> parametersVec_;
+	std::size_t lazySize_ = 0;
+	generator_t generator_;
 };
 
 
-using parameterInstanceMap_t  = std::map<std::string, Parameter >;
+using parameterInstanceMap_t  = std::pmr::map<std::string, Parameter >;
 using parameterCombinations_t = std::map<std::string, ParametersVec>;
 using stringSet_t = std::set<std::string>;
 using stringSetMap_t = std::map<std::string, stringSet_t >;
 using dontCares_t = std::map<std::string, std::unordered_map<Parameter, std::set<std::string> , ParameterHasher> >;
 
+struct ParameterBranch;
+
+// Tree structured parameter specification. 'branches' maps the name of a parameter to the values of it
+// that own a sub-space; the parameters of a sub-space only exist in combinations holding that value.
+struct ParameterSpace
+{
+	parameterCombinations_t parameters;
+	std::map<std::string, std::vector<ParameterBranch>> branches;
+};
+
+struct ParameterBranch
+{
+	Parameter value;
+	ParameterSpace space;
+};
+
 template<typename T>
 auto getVal(const Parameter& param)
 {
@@ -274,69 +493,27 @@ auto getVal(const parameterInstanceMap_t& paramInstance, const std::string& key)
 	return getVal<T>(paramInstance.at(key));
 }
 
+class CompiledDontCares;
+
+// Orders instances by their (name, value) pairs. Built from don't cares it first removes the parameters they disable,
+// so instances that only differ in don't care parameters are equivalent. This is a strict weak ordering for any mix
+// of instances, including instances with different parameter names. The result sets of ParameterCombinator hold
+// instances that are already stripped and use the plain ordering (see ParameterCombinator::contains()).
 struct ParameterInstanceSetCompare
 {
-	dontCares_t dontCares_;
+	// Compiled rules shared by all copies of the comparator. Null when there are no don't cares.
+	std::shared_ptr<const CompiledDontCares> rules_;
+	// Incremented on every comparison when set. Used to collect combine() statistics.
+	std::shared_ptr<std::atomic<std::uint64_t>> callCounter_;
 	ParameterInstanceSetCompare()
-		: dontCares_()
 	{};
-	ParameterInstanceSetCompare(const dontCares_t& dontCares)
-		: dontCares_(dontCares)
-	{};
-	bool operator()(const parameterInstanceMap_t& a, const parameterInstanceMap_t& b) const
-	{
-		for (auto& param : a)
-		{
-			bool skip = false;
-			for (auto& dontCare : dontCares_)
-			{
-				const std::string& dontCareKey = dontCare.first;
-
-				// Total don't care. This parameter is completely ignored
-				bool totalDontCare = param.first == dontCareKey && dontCare.second.empty();
-
-				// Traditional don't care.
-				bool normalDontCare =
-					!dontCare.second.empty()
-					&& b.count(dontCareKey)
-					&& dontCare.second.count(b.at(dontCareKey))
-					&& dontCare.second.at(b.at(dontCareKey)).count(param.first);
-
-				if (totalDontCare || normalDontCare)
-				{
-					skip = true;
-					break;
-				}
-			}
-			if (skip || (b.count(param.first) && (param.second == b.at(param.first)))
-				|| (!b.count(param.first) && a.count(param.first))) // Compare paramInstances of different sizes (happens at addCombinations)
-			{
-				continue;
-			}
-			else
-			{
-				if (b.count(param.first))
-				{
-					if (param.second < b.at(param.first))
-					{
-						return true;
-					}
-					else
-					{
-						return false;
-					}
-				}
-				else
-				{
-					return false;
-				}
-			}
-		}
-		return false;
-	}
+	ParameterInstanceSetCompare(const dontCares_t& dontCares);
+	bool operator()(const parameterInstanceMap_t& a, const parameterInstanceMap_t& b) const;
 };
 
-using parameterInstanceSet_t = std::set<parameterInstanceMap_t, ParameterInstanceSetCompare>;
+// Instance maps and sets take a std::pmr memory resource so a whole result set can live in an arena
+// (see StorageMode). By default they allocate from the global heap like std::map and std::set.
+using parameterInstanceSet_t = std::pmr::set<parameterInstanceMap_t, ParameterInstanceSetCompare>;
 
 } // Namespace parameterCombinator
 
@@ -0,0 +1,379 @@
+#include "ProcessPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace parameterCombinator
+{
+	ProcessPool::ProcessPool(const ProcessPoolOptions& options)
+		: options_(options)
+	{
+		if (!options_.pipelineDepth || !options_.attempts)
+		{
+			throw std::invalid_argument("Pipeline depth and attempts must be larger than zero.");
+		}
+	}
+
+#ifdef _WIN32
+
+	ProcessPoolResult ProcessPool::run(const parameterInstanceSet_t&, const evaluator_t&)
+	{
+		throw std::invalid_argument("ProcessPool is not supported on this platform.");
+	}
+
+#else
+
+	namespace
+	{
+		// Result slot of one combination in the shared region
+		struct ResultSlot
+		{
+			std::atomic<std::uint32_t> status;
+			std::uint32_t size;
+		};
+
+		// Shared anonymous mapping holding one slot followed by 'resultSize' bytes per combination
+		class SharedResults
+		{
+		public:
+			SharedResults(std::size_t count, std::size_t resultSize)
+				: stride_((sizeof(ResultSlot) + resultSize + alignof(ResultSlot) - 1) / alignof(ResultSlot) * alignof(ResultSlot))
+				, resultSize_(resultSize)
+				, bytes_(std::max<std::size_t>(1, count * stride_))
+			{
+				region_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+				if (region_ == MAP_FAILED)
+				{
+					throw std::runtime_error("Failed to map the shared result region.");
+				}
+				for (std::size_t index = 0; index < count; ++index)
+				{
+					new (&slot(index)) ResultSlot{ {static_cast<std::uint32_t>(EvaluationStatus::Pending)}, 0 };
+				}
+			}
+			~SharedResults()
+			{
+				munmap(region_, bytes_);
+			}
+			ResultSlot& slot(std::size_t index)
+			{
+				return *reinterpret_cast<ResultSlot*>(static_cast<char*>(region_) + index * stride_);
+			}
+			char* data(std::size_t index)
+			{
+				return reinterpret_cast<char*>(&slot(index)) + sizeof(ResultSlot);
+			}
+			void store(std::size_t index, EvaluationStatus status, const std::string& result)
+			{
+				std::size_t size = std::min(result.size(), resultSize_);
+				std::memcpy(data(index), result.data(), size);
+				slot(index).size = static_cast<std::uint32_t>(size);
+				slot(index).status.store(static_cast<std::uint32_t>(status), std::memory_order_release);
+			}
+			EvaluationStatus status(std::size_t index)
+			{
+				return static_cast<EvaluationStatus>(slot(index).status.load(std::memory_order_acquire));
+			}
+			std::string result(std::size_t index)
+			{
+				return std::string(data(index), slot(index).size);
+			}
+		private:
+			std::size_t stride_;
+			std::size_t resultSize_;
+			std::size_t bytes_;
+			void* region_ = nullptr;
+		};
+
+		struct Worker
+		{
+			pid_t pid = -1;
+			int socket = -1;
+			// Indices sent and not acknowledged yet, oldest first. The worker runs them in order.
+			std::deque<std::size_t> inFlight;
+		};
+
+		bool sendAll(int socket, const void* data, std::size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			while (size)
+			{
+				ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+				if (sent < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (sent <= 0)
+				{
+					return false;
+				}
+				bytes += sent;
+				size -= static_cast<std::size_t>(sent);
+			}
+			return true;
+		}
+
+		bool receiveAll(int socket, void* data, std::size_t size)
+		{
+			char* bytes = static_cast<char*>(data);
+			while (size)
+			{
+				ssize_t received = recv(socket, bytes, size, 0);
+				if (received < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (received <= 0)
+				{
+					return false;
+				}
+				bytes += received;
+				size -= static_cast<std::size_t>(received);
+			}
+			return true;
+		}
+
+		// Body of a worker process. Never returns.
+		[[noreturn]] void workerMain(int socket, const std::vector<const parameterInstanceMap_t*>& instances,
+			SharedResults& results, const ProcessPool::evaluator_t& evaluator)
+		{
+			std::uint64_t index = 0;
+			while (receiveAll(socket, &index, sizeof(index)))
+			{
+				try
+				{
+					results.store(index, EvaluationStatus::Done, evaluator(*instances[index]));
+				}
+				catch (const std::exception& exception)
+				{
+					results.store(index, EvaluationStatus::Failed, exception.what());
+				}
+				catch (...)
+				{
+					results.store(index, EvaluationStatus::Failed, "Unknown exception");
+				}
+				if (!sendAll(socket, &index, sizeof(index)))
+				{
+					break;
+				}
+			}
+			// Skip the destructors and exit handlers of the copy of the parent
+			_exit(0);
+		}
+	}
+
+	ProcessPoolResult ProcessPool::run(const parameterInstanceSet_t& paramSet, const evaluator_t& evaluator)
+	{
+		std::vector<const parameterInstanceMap_t*> instances;
+		instances.reserve(paramSet.size());
+		for (auto& paramInstance : paramSet)
+		{
+			instances.push_back(&paramInstance);
+		}
+		SharedResults results(instances.size(), options_.resultSize);
+		std::vector<std::size_t> crashes(instances.size(), 0);
+
+		ProcessPoolResult poolResult;
+		std::size_t workerCount = options_.workers ? options_.workers : std::max(1u, std::thread::hardware_concurrency());
+		workerCount = std::max<std::size_t>(1, std::min(workerCount, instances.size()));
+		std::vector<Worker> workers(instances.empty() ? 0 : workerCount);
+
+		auto spawn = [&](Worker& worker)
+		{
+			int sockets[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+			{
+				throw std::runtime_error("Failed to create a worker socket.");
+			}
+			pid_t pid = fork();
+			if (pid < 0)
+			{
+				close(sockets[0]);
+				close(sockets[1]);
+				throw std::runtime_error("Failed to fork a worker.");
+			}
+			if (pid == 0)
+			{
+				close(sockets[0]);
+				for (auto& other : workers)
+				{
+					if (other.socket >= 0)
+					{
+						close(other.socket);
+					}
+				}
+				workerMain(sockets[1], instances, results, evaluator);
+			}
+			close(sockets[1]);
+			worker.pid = pid;
+			worker.socket = sockets[0];
+			worker.inFlight.clear();
+		};
+
+		std::deque<std::size_t> queue;
+		for (std::size_t index = 0; index < instances.size(); ++index)
+		{
+			queue.push_back(index);
+		}
+		auto dispatch = [&](Worker& worker)
+		{
+			while (!queue.empty() && worker.inFlight.size() < options_.pipelineDepth)
+			{
+				std::uint64_t index = queue.front();
+				if (!sendAll(worker.socket, &index, sizeof(index)))
+				{
+					// The worker died. Its socket reports the hang up to the poll loop.
+					return;
+				}
+				queue.pop_front();
+				worker.inFlight.push_back(index);
+			}
+		};
+		// Collects a dead worker. Returns the number of its combinations that are settled: finished but not
+		// acknowledged, or given up after crashing.
+		auto reap = [&](Worker& worker)
+		{
+			std::size_t settled = 0;
+			close(worker.socket);
+			worker.socket = -1;
+			int status = 0;
+			while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR)
+			{
+			}
+			// Combinations run in order, so the oldest one without a result is the one that was running.
+			// The ones after it never started.
+			bool running = true;
+			for (std::size_t index : worker.inFlight)
+			{
+				if (results.status(index) != EvaluationStatus::Pending)
+				{
+					++settled;
+					continue;
+				}
+				bool crashed = running;
+				running = false;
+				if (!crashed || ++crashes[index] < options_.attempts)
+				{
+					queue.push_front(index);
+					continue;
+				}
+				CrashRecord crash;
+				crash.index = index;
+				crash.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+				crash.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+				poolResult.crashes.push_back(crash);
+				results.store(index, EvaluationStatus::Crashed, "");
+				++settled;
+			}
+			worker.inFlight.clear();
+			return settled;
+		};
+
+		// Kills and collects the started workers when the pool fails, so no child outlives it
+		auto killAll = [&]()
+		{
+			for (auto& worker : workers)
+			{
+				if (worker.socket < 0)
+				{
+					continue;
+				}
+				close(worker.socket);
+				worker.socket = -1;
+				kill(worker.pid, SIGKILL);
+				while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+				{
+				}
+			}
+		};
+
+		try
+		{
+			for (auto& worker : workers)
+			{
+				spawn(worker);
+				dispatch(worker);
+			}
+
+			std::size_t finished = 0;
+			std::vector<pollfd> fds(workers.size());
+			while (finished < instances.size())
+			{
+				for (std::size_t w = 0; w < workers.size(); ++w)
+				{
+					fds[w] = { workers[w].socket, POLLIN, 0 };
+				}
+				if (poll(fds.data(), fds.size(), -1) < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw std::runtime_error("Failed to poll the workers.");
+				}
+				for (std::size_t w = 0; w < workers.size(); ++w)
+				{
+					Worker& worker = workers[w];
+					if (!fds[w].revents)
+					{
+						continue;
+					}
+					std::uint64_t index = 0;
+					if ((fds[w].revents & POLLIN) && receiveAll(worker.socket, &index, sizeof(index)))
+					{
+						worker.inFlight.pop_front();
+						++finished;
+						dispatch(worker);
+						continue;
+					}
+					finished += reap(worker);
+					if (finished < instances.size())
+					{
+						spawn(worker);
+						++poolResult.respawns;
+						dispatch(worker);
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			killAll();
+			throw;
+		}
+
+		for (auto& worker : workers)
+		{
+			if (worker.socket >= 0)
+			{
+				// Closing the socket ends the worker loop
+				close(worker.socket);
+				while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR)
+				{
+				}
+			}
+		}
+
+		for (std::size_t index = 0; index < instances.size(); ++index)
+		{
+			poolResult.status.push_back(results.status(index));
+			poolResult.results.push_back(results.result(index));
+		}
+		return poolResult;
+	}
+
+#endif
+
+} // Namespace parameterCombinator
@@ -0,0 +1,65 @@
+#pragma once
+#include "Parameters.h"
+#include <cstdint>
+
+namespace parameterCombinator
+{
+	struct ProcessPoolOptions
+	{
+		// Number of worker processes. 0 uses one per hardware thread.
+		std::size_t workers = 0;
+		// Bytes of shared memory reserved for the result of every combination. Longer results are truncated.
+		std::size_t resultSize = 256;
+		// Combinations sent to a worker before it acknowledges the first one. Hides the round trip to the worker.
+		std::size_t pipelineDepth = 2;
+		// Runs of a combination that may crash its worker before it is given up
+		std::size_t attempts = 1;
+	};
+
+	enum class EvaluationStatus : std::uint32_t
+	{
+		Pending,
+		Done,
+		// The evaluator threw. The result holds the exception message.
+		Failed,
+		// The worker process died while evaluating the combination
+		Crashed
+	};
+
+	struct CrashRecord
+	{
+		// Position of the combination in the evaluated set
+		std::size_t index = 0;
+		// Signal that killed the worker, or 0 if it exited
+		int signal = 0;
+		int exitCode = 0;
+	};
+
+	struct ProcessPoolResult
+	{
+		// One entry per combination, in the iteration order of the evaluated set
+		std::vector<EvaluationStatus> status;
+		std::vector<std::string> results;
+		std::vector<CrashRecord> crashes;
+		// Workers started to replace crashed ones
+		std::size_t respawns = 0;
+	};
+
+	// Evaluates combinations in forked worker processes, so crashes and leaks in the code under test do not take the
+	// sweep down. Workers are forked once with the combination set already in memory and receive combination indices
+	// over a socket; results are written to a shared memory region. A worker that dies is replaced and the
+	// combination it was running is recorded as crashed.
+	// POSIX only. Fork from a process that runs no other threads, as only the calling thread exists in the workers.
+	class ProcessPool
+	{
+	public:
+		using evaluator_t = std::function<std::string(const parameterInstanceMap_t&)>;
+
+		explicit ProcessPool(const ProcessPoolOptions& options = ProcessPoolOptions{});
+		ProcessPoolResult run(const parameterInstanceSet_t& paramSet, const evaluator_t& evaluator);
+
+	private:
+		ProcessPoolOptions options_;
+	};
+
+} // Namespace parameterCombinator
@@ -0,0 +1,129 @@
+#include "RecordLog.h"
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+
+namespace parameterCombinator
+{
+	// Identifies record logs and their format version
+	static const std::string logMagic = "PCRLOG01";
+	static constexpr std::size_t recordHeaderSize = 8;
+
+	static std::uint32_t readUint32(const std::string& bytes, std::size_t offset)
+	{
+		std::uint32_t value = 0;
+		for (std::size_t i = 0; i < 4; ++i)
+		{
+			value |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[offset + i])) << (8 * i);
+		}
+		return value;
+	}
+
+	static void writeUint32(std::string& bytes, std::uint32_t value)
+	{
+		for (std::size_t i = 0; i < 4; ++i)
+		{
+			bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+		}
+	}
+
+	RecordLog::RecordLog(const std::string& path, const replay_t& replay)
+		: path_(path)
+	{
+		std::string contents;
+		{
+			std::ifstream in(path_, std::ios::binary | std::ios::ate);
+			if (in)
+			{
+				contents.resize(static_cast<std::size_t>(in.tellg()));
+				in.seekg(0);
+				in.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+				contents.resize(static_cast<std::size_t>(in.gcount()));
+			}
+		}
+
+		std::size_t validEnd = 0;
+		// A log shorter than its magic was torn while being created and starts over
+		if (contents.size() >= logMagic.size())
+		{
+			if (contents.compare(0, logMagic.size(), logMagic) != 0)
+			{
+				throw std::invalid_argument(path_ + " is not a record log.");
+			}
+			validEnd = logMagic.size();
+			while (contents.size() - validEnd >= recordHeaderSize)
+			{
+				std::uint32_t size = readUint32(contents, validEnd);
+				std::uint32_t expectedChecksum = readUint32(contents, validEnd + 4);
+				if (contents.size() - validEnd - recordHeaderSize < size)
+				{
+					break;
+				}
+				std::string payload = contents.substr(validEnd + recordHeaderSize, size);
+				if (checksum(payload) != expectedChecksum)
+				{
+					break;
+				}
+				if (replay)
+				{
+					replay(payload);
+				}
+				validEnd += recordHeaderSize + size;
+			}
+		}
+
+		if (validEnd < contents.size())
+		{
+			truncatedBytes_ = contents.size() - validEnd;
+			std::filesystem::resize_file(path_, validEnd);
+		}
+		file_.open(path_, std::ios::binary | std::ios::app);
+		if (!file_)
+		{
+			throw std::invalid_argument("Can not open " + path_ + " for writing.");
+		}
+		if (validEnd == 0)
+		{
+			file_ << logMagic;
+			file_.flush();
+		}
+	}
+
+	void RecordLog::append(const std::string& payload)
+	{
+		std::string record;
+		record.reserve(recordHeaderSize + payload.size());
+		writeUint32(record, static_cast<std::uint32_t>(payload.size()));
+		writeUint32(record, checksum(payload));
+		record += payload;
+		// One write call per record keeps torn records at the tail, where opening the log removes them
+		file_.write(record.data(), static_cast<std::streamsize>(record.size()));
+		file_.flush();
+		if (!file_)
+		{
+			throw std::runtime_error("Failed to append to " + path_ + ".");
+		}
+	}
+
+	std::size_t RecordLog::truncatedBytes() const
+	{
+		return truncatedBytes_;
+	}
+
+	const std::string& RecordLog::path() const
+	{
+		return path_;
+	}
+
+	std::uint32_t RecordLog::checksum(const std::string& payload)
+	{
+		std::uint32_t hash = 2166136261u;
+		for (unsigned char c : payload)
+		{
+			hash ^= c;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+} // Namespace parameterCombinator
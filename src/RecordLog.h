@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <functional>
+#include <cstdint>
+
+namespace parameterCombinator
+{
+	// Append-only file of checksummed records. Each record is framed as
+	// [payload size: uint32][FNV-1a checksum of the payload: uint32][payload], little endian.
+	// Opening a log replays the valid records and truncates whatever follows the last of them, so a record torn by a
+	// crash in the middle of a write is dropped instead of corrupting the records appended after it.
+	class RecordLog
+	{
+	public:
+		using replay_t = std::function<void(const std::string& payload)>;
+
+		// Opens 'path', creating it if needed, and calls 'replay' with the payload of every valid record in order.
+		// Throws std::invalid_argument if the file exists but is not a record log.
+		RecordLog(const std::string& path, const replay_t& replay = replay_t{});
+		RecordLog(const RecordLog&) = delete;
+		RecordLog& operator=(const RecordLog&) = delete;
+
+		// Writes a record and flushes it to the operating system, so it survives the process being killed
+		void append(const std::string& payload);
+		// Bytes of torn or corrupt records removed when the log was opened
+		std::size_t truncatedBytes() const;
+		const std::string& path() const;
+
+		static std::uint32_t checksum(const std::string& payload);
+
+	private:
+		std::string path_;
+		std::ofstream file_;
+		std::size_t truncatedBytes_ = 0;
+	};
+
+} // Namespace parameterCombinator
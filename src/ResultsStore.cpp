@@ -0,0 +1,514 @@
+#include "ResultsStore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// Records start with a tag:
+		// 'R' run name                                      -> next run index
+		// 'C' name, parameter count, (parameter, value)...  -> next combination index
+		// 'S' run index, combination index, samples...
+		// Integers are uint32 little endian, strings are prefixed by their uint32 size, samples are IEEE doubles.
+		class PayloadWriter
+		{
+		public:
+			explicit PayloadWriter(char tag)
+			{
+				payload_.push_back(tag);
+			}
+			void uint32(std::uint32_t value)
+			{
+				for (std::size_t i = 0; i < 4; ++i)
+				{
+					payload_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+				}
+			}
+			void string(const std::string& text)
+			{
+				uint32(static_cast<std::uint32_t>(text.size()));
+				payload_ += text;
+			}
+			void sample(double value)
+			{
+				std::uint64_t bits = 0;
+				std::memcpy(&bits, &value, sizeof(bits));
+				for (std::size_t i = 0; i < 8; ++i)
+				{
+					payload_.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+				}
+			}
+			const std::string& payload() const
+			{
+				return payload_;
+			}
+		private:
+			std::string payload_;
+		};
+
+		// Reads a payload written by PayloadWriter. Reading past the end clears ok() instead of throwing.
+		class PayloadReader
+		{
+		public:
+			explicit PayloadReader(const std::string& payload)
+				: payload_(payload), offset_(1)
+			{
+			}
+			bool ok() const
+			{
+				return ok_;
+			}
+			std::size_t remaining() const
+			{
+				return payload_.size() - offset_;
+			}
+			std::uint32_t uint32()
+			{
+				if (!take(4))
+				{
+					return 0;
+				}
+				std::uint32_t value = 0;
+				for (std::size_t i = 0; i < 4; ++i)
+				{
+					value |= static_cast<std::uint32_t>(static_cast<unsigned char>(payload_[offset_ - 4 + i])) << (8 * i);
+				}
+				return value;
+			}
+			std::string string()
+			{
+				std::uint32_t size = uint32();
+				if (!take(size))
+				{
+					return std::string();
+				}
+				return payload_.substr(offset_ - size, size);
+			}
+			double sample()
+			{
+				if (!take(8))
+				{
+					return 0.0;
+				}
+				std::uint64_t bits = 0;
+				for (std::size_t i = 0; i < 8; ++i)
+				{
+					bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(payload_[offset_ - 8 + i])) << (8 * i);
+				}
+				double value = 0.0;
+				std::memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+		private:
+			bool take(std::size_t bytes)
+			{
+				if (!ok_ || remaining() < bytes)
+				{
+					ok_ = false;
+					return false;
+				}
+				offset_ += bytes;
+				return true;
+			}
+
+			const std::string& payload_;
+			std::size_t offset_;
+			bool ok_ = true;
+		};
+
+		struct Moments
+		{
+			std::size_t n = 0;
+			double mean = 0.0;
+			// Sample variance
+			double variance = 0.0;
+		};
+
+		Moments moments(const std::vector<double>& samples)
+		{
+			Moments result;
+			result.n = samples.size();
+			result.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(result.n);
+			double squares = 0.0;
+			for (double sample : samples)
+			{
+				squares += (sample - result.mean) * (sample - result.mean);
+			}
+			result.variance = result.n > 1 ? squares / static_cast<double>(result.n - 1) : 0.0;
+			return result;
+		}
+
+		// Continued fraction of the incomplete beta function, evaluated with the modified Lentz method
+		double betaContinuedFraction(double a, double b, double x)
+		{
+			const double tiny = 1e-300;
+			auto nonZero = [&](double value)
+			{
+				return std::fabs(value) < tiny ? tiny : value;
+			};
+			double c = 1.0;
+			double d = 1.0 / nonZero(1.0 - (a + b) * x / (a + 1.0));
+			double fraction = d;
+			for (int m = 1; m <= 300; ++m)
+			{
+				double even = m * (b - m) * x / ((a + 2.0 * m - 1.0) * (a + 2.0 * m));
+				d = 1.0 / nonZero(1.0 + even * d);
+				c = nonZero(1.0 + even / c);
+				fraction *= d * c;
+				double odd = -(a + m) * (a + b + m) * x / ((a + 2.0 * m) * (a + 2.0 * m + 1.0));
+				d = 1.0 / nonZero(1.0 + odd * d);
+				c = nonZero(1.0 + odd / c);
+				fraction *= d * c;
+				if (std::fabs(d * c - 1.0) < 1e-14)
+				{
+					break;
+				}
+			}
+			return fraction;
+		}
+
+		// Regularized incomplete beta function I_x(a, b)
+		double incompleteBeta(double a, double b, double x)
+		{
+			if (x <= 0.0)
+			{
+				return 0.0;
+			}
+			if (x >= 1.0)
+			{
+				return 1.0;
+			}
+			double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x));
+			// The fraction converges quickly on this side of the mean, use the symmetry on the other
+			if (x < (a + 1.0) / (a + b + 2.0))
+			{
+				return front * betaContinuedFraction(a, b, x) / a;
+			}
+			return 1.0 - front * betaContinuedFraction(b, a, 1.0 - x) / b;
+		}
+
+		// P(T >= t) for Student's t distribution with 'df' degrees of freedom
+		double studentUpperTail(double t, double df)
+		{
+			double tail = 0.5 * incompleteBeta(df / 2.0, 0.5, df / (df + t * t));
+			return t > 0.0 ? tail : 1.0 - tail;
+		}
+
+		// One-sided p-value of 'candidate' having a larger mean than 'baseline' (Welch's unequal variances t-test)
+		double welchPValue(const Moments& baseline, const Moments& candidate)
+		{
+			double baselineError = baseline.variance / static_cast<double>(baseline.n);
+			double candidateError = candidate.variance / static_cast<double>(candidate.n);
+			double squaredError = baselineError + candidateError;
+			double difference = candidate.mean - baseline.mean;
+			if (squaredError <= 0.0)
+			{
+				return difference > 0.0 ? 0.0 : 1.0;
+			}
+			double df = squaredError * squaredError / (baselineError * baselineError / static_cast<double>(baseline.n - 1) +
+				candidateError * candidateError / static_cast<double>(candidate.n - 1));
+			return studentUpperTail(difference / std::sqrt(squaredError), df);
+		}
+
+		// Benjamini-Hochberg: the hypotheses rejected at the given false discovery rate
+		std::vector<bool> discoveries(const std::vector<double>& pValues, double rate)
+		{
+			std::vector<std::size_t> order(pValues.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
+			{
+				return pValues[lhs] < pValues[rhs];
+			});
+			std::size_t rejected = 0;
+			for (std::size_t rank = 0; rank < order.size(); ++rank)
+			{
+				if (pValues[order[rank]] <= rate * static_cast<double>(rank + 1) / static_cast<double>(order.size()))
+				{
+					rejected = rank + 1;
+				}
+			}
+			std::vector<bool> discovered(pValues.size(), false);
+			for (std::size_t rank = 0; rank < rejected; ++rank)
+			{
+				discovered[order[rank]] = true;
+			}
+			return discovered;
+		}
+	}
+
+	ResultsStore::ResultsStore(const std::string& path)
+		: log_(path, [this](const std::string& payload)
+		{
+			replay(payload);
+		})
+	{
+	}
+
+	void ResultsStore::replay(const std::string& payload)
+	{
+		if (payload.empty())
+		{
+			return;
+		}
+		PayloadReader reader(payload);
+		switch (payload[0])
+		{
+		case 'R':
+		{
+			std::string run = reader.string();
+			if (reader.ok() && runIndices_.emplace(run, static_cast<std::uint32_t>(runs_.size())).second)
+			{
+				runs_.push_back(run);
+				samples_.emplace_back();
+			}
+			break;
+		}
+		case 'C':
+		{
+			Combination combination;
+			combination.name = reader.string();
+			std::uint32_t count = reader.uint32();
+			for (std::uint32_t i = 0; i < count && reader.ok(); ++i)
+			{
+				std::string parameter = reader.string();
+				std::string value = reader.string();
+				auto [index, isNew] = valueIndices_.try_emplace(parameter + '\0' + value, static_cast<std::uint32_t>(values_.size()));
+				if (isNew)
+				{
+					values_.emplace_back(std::move(parameter), std::move(value));
+				}
+				combination.values.push_back(index->second);
+			}
+			if (reader.ok() && combinationIndices_.emplace(combination.name, static_cast<std::uint32_t>(combinations_.size())).second)
+			{
+				combinations_.push_back(std::move(combination));
+			}
+			break;
+		}
+		case 'S':
+		{
+			std::uint32_t run = reader.uint32();
+			std::uint32_t combination = reader.uint32();
+			if (!reader.ok() || run >= runs_.size() || combination >= combinations_.size())
+			{
+				break;
+			}
+			auto& runSamples = samples_[run];
+			if (runSamples.size() <= combination)
+			{
+				runSamples.resize(combinations_.size());
+			}
+			while (reader.remaining() >= 8)
+			{
+				runSamples[combination].push_back(reader.sample());
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void ResultsStore::record(const std::string& run, const parameterInstanceMap_t& paramInstance, const std::vector<double>& samples)
+	{
+		std::string name = ParameterCombinator::generateCombinationName(paramInstance);
+		std::lock_guard<std::mutex> lock(mutex_);
+		// Appended records go through replay() too, so the index is built by one code path
+		auto append = [&](const PayloadWriter& writer)
+		{
+			log_.append(writer.payload());
+			replay(writer.payload());
+		};
+		if (!runIndices_.count(run))
+		{
+			PayloadWriter writer('R');
+			writer.string(run);
+			append(writer);
+		}
+		if (!combinationIndices_.count(name))
+		{
+			PayloadWriter writer('C');
+			writer.string(name);
+			writer.uint32(static_cast<std::uint32_t>(paramInstance.size()));
+			for (auto& [parameter, value] : paramInstance)
+			{
+				writer.string(parameter);
+				writer.string(value->toString());
+			}
+			append(writer);
+		}
+		PayloadWriter writer('S');
+		writer.uint32(runIndices_.at(run));
+		writer.uint32(combinationIndices_.at(name));
+		for (double sample : samples)
+		{
+			writer.sample(sample);
+		}
+		append(writer);
+	}
+
+	std::vector<std::string> ResultsStore::runs() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return runs_;
+	}
+
+	std::size_t ResultsStore::combinations() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return combinations_.size();
+	}
+
+	std::vector<double> ResultsStore::samples(const std::string& run, const std::string& combinationName) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto runEntry = runIndices_.find(run);
+		auto combination = combinationIndices_.find(combinationName);
+		if (runEntry == runIndices_.end() || combination == combinationIndices_.end())
+		{
+			return {};
+		}
+		auto* found = find(runEntry->second, combination->second);
+		return found ? *found : std::vector<double>{};
+	}
+
+	std::vector<double> ResultsStore::samples(const std::string& run, const parameterInstanceMap_t& paramInstance) const
+	{
+		return samples(run, ParameterCombinator::generateCombinationName(paramInstance));
+	}
+
+	std::size_t ResultsStore::truncatedBytes() const
+	{
+		return log_.truncatedBytes();
+	}
+
+	std::uint32_t ResultsStore::runIndex(const std::string& run) const
+	{
+		auto entry = runIndices_.find(run);
+		if (entry == runIndices_.end())
+		{
+			throw std::invalid_argument("Run " + run + " has no results.");
+		}
+		return entry->second;
+	}
+
+	const std::vector<double>* ResultsStore::find(std::uint32_t run, std::uint32_t combination) const
+	{
+		auto& runSamples = samples_[run];
+		if (combination >= runSamples.size() || runSamples[combination].empty())
+		{
+			return nullptr;
+		}
+		return &runSamples[combination];
+	}
+
+	RegressionReport ResultsStore::compare(const std::string& baseline, const std::string& candidate,
+		const RegressionOptions& options) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::uint32_t baselineRun = runIndex(baseline);
+		std::uint32_t candidateRun = runIndex(candidate);
+
+		RegressionReport report;
+		std::vector<CombinationRegression> tested;
+		std::vector<double> pValues;
+		// Log ratios of the combination means, summed per parameter value
+		struct LogRatios
+		{
+			std::size_t n = 0;
+			double sum = 0.0;
+			double squares = 0.0;
+		};
+		std::vector<LogRatios> logRatios(values_.size());
+		for (std::uint32_t combination = 0; combination < combinations_.size(); ++combination)
+		{
+			auto* baselineSamples = find(baselineRun, combination);
+			auto* candidateSamples = find(candidateRun, combination);
+			if (!baselineSamples || !candidateSamples)
+			{
+				continue;
+			}
+			++report.compared;
+			Moments before = moments(*baselineSamples);
+			Moments after = moments(*candidateSamples);
+			if (before.mean > 0.0 && after.mean > 0.0)
+			{
+				double logRatio = std::log(after.mean / before.mean);
+				for (auto value : combinations_[combination].values)
+				{
+					++logRatios[value].n;
+					logRatios[value].sum += logRatio;
+					logRatios[value].squares += logRatio * logRatio;
+				}
+			}
+			// A single sample says nothing about the noise of a combination
+			if (before.n < 2 || after.n < 2 || before.mean <= 0.0)
+			{
+				continue;
+			}
+			CombinationRegression regression;
+			regression.name = combinations_[combination].name;
+			regression.baselineSamples = before.n;
+			regression.candidateSamples = after.n;
+			regression.baselineMean = before.mean;
+			regression.candidateMean = after.mean;
+			regression.slowdown = after.mean / before.mean - 1.0;
+			regression.pValue = welchPValue(before, after);
+			pValues.push_back(regression.pValue);
+			tested.push_back(std::move(regression));
+		}
+		auto slowCombinations = discoveries(pValues, options.falseDiscoveryRate);
+		for (std::size_t i = 0; i < tested.size(); ++i)
+		{
+			if (slowCombinations[i] && tested[i].slowdown >= options.minSlowdown)
+			{
+				report.combinations.push_back(std::move(tested[i]));
+			}
+		}
+
+		std::vector<ValueRegression> testedValues;
+		pValues.clear();
+		for (std::size_t value = 0; value < values_.size(); ++value)
+		{
+			auto& ratios = logRatios[value];
+			if (ratios.n < 2)
+			{
+				continue;
+			}
+			double n = static_cast<double>(ratios.n);
+			double mean = ratios.sum / n;
+			double variance = std::max(0.0, (ratios.squares - n * mean * mean) / (n - 1.0));
+			ValueRegression regression;
+			regression.parameter = values_[value].first;
+			regression.value = values_[value].second;
+			regression.combinations = ratios.n;
+			regression.slowdown = std::exp(mean) - 1.0;
+			double error = std::sqrt(variance / n);
+			regression.pValue = error > 0.0 ? studentUpperTail(mean / error, n - 1.0) : (mean > 0.0 ? 0.0 : 1.0);
+			pValues.push_back(regression.pValue);
+			testedValues.push_back(std::move(regression));
+		}
+		auto slowValues = discoveries(pValues, options.falseDiscoveryRate);
+		for (std::size_t i = 0; i < testedValues.size(); ++i)
+		{
+			if (slowValues[i] && testedValues[i].slowdown >= options.minSlowdown)
+			{
+				report.values.push_back(std::move(testedValues[i]));
+			}
+		}
+
+		std::sort(report.combinations.begin(), report.combinations.end(), [](const CombinationRegression& lhs, const CombinationRegression& rhs)
+		{
+			return lhs.slowdown > rhs.slowdown;
+		});
+		std::sort(report.values.begin(), report.values.end(), [](const ValueRegression& lhs, const ValueRegression& rhs)
+		{
+			return lhs.slowdown > rhs.slowdown;
+		});
+		return report;
+	}
+
+} // Namespace parameterCombinator
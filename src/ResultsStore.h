@@ -0,0 +1,104 @@
+#pragma once
+#include "ParameterCombinator.h"
+#include "RecordLog.h"
+#include <mutex>
+
+namespace parameterCombinator
+{
+	struct RegressionOptions
+	{
+		// Expected fraction of false alarms among the reported slowdowns (Benjamini-Hochberg), applied separately to
+		// the combinations and to the parameter values
+		double falseDiscoveryRate = 0.01;
+		// Smallest slowdown reported, relative to the baseline: 0.02 ignores anything below 2 %
+		double minSlowdown = 0.02;
+	};
+
+	// Combination significantly slower in the candidate run (one-sided Welch t-test on the samples)
+	struct CombinationRegression
+	{
+		std::string name;
+		std::size_t baselineSamples = 0;
+		std::size_t candidateSamples = 0;
+		double baselineMean = 0.0;
+		double candidateMean = 0.0;
+		// candidateMean / baselineMean - 1
+		double slowdown = 0.0;
+		double pValue = 1.0;
+	};
+
+	// Parameter value whose combinations got slower: one-sided t-test on the log ratios of the combination means
+	struct ValueRegression
+	{
+		std::string parameter;
+		std::string value;
+		std::size_t combinations = 0;
+		// Geometric mean of candidate / baseline over its combinations, minus 1
+		double slowdown = 0.0;
+		double pValue = 1.0;
+	};
+
+	struct RegressionReport
+	{
+		// Combinations with samples in both runs
+		std::size_t compared = 0;
+		// Sorted by slowdown, largest first
+		std::vector<CombinationRegression> combinations;
+		// Sorted by slowdown, largest first
+		std::vector<ValueRegression> values;
+	};
+
+	// Timing samples of benchmark sweeps over many runs, keyed by ParameterCombinator::generateCombinationName().
+	// Stored in an append-only RecordLog: a combination and its parameter values are written once, later samples only
+	// refer to it and to their run by index. Opening the store replays the log into an in-memory index.
+	class ResultsStore
+	{
+	public:
+		explicit ResultsStore(const std::string& path);
+
+		// Appends timing samples of 'paramInstance' measured by 'run'. Samples of a run and combination accumulate.
+		// Safe to call from several threads.
+		void record(const std::string& run, const parameterInstanceMap_t& paramInstance, const std::vector<double>& samples);
+		// Runs in the order they were first recorded
+		std::vector<std::string> runs() const;
+		// Number of distinct combinations over all runs
+		std::size_t combinations() const;
+		// Samples of a combination in a run, empty if it has none
+		std::vector<double> samples(const std::string& run, const std::string& combinationName) const;
+		std::vector<double> samples(const std::string& run, const parameterInstanceMap_t& paramInstance) const;
+		// Bytes of torn records dropped when the store was opened
+		std::size_t truncatedBytes() const;
+
+		// Combinations and parameter values significantly slower in 'candidate' than in 'baseline'. Throws
+		// std::invalid_argument for unknown runs.
+		RegressionReport compare(const std::string& baseline, const std::string& candidate,
+			const RegressionOptions& options = RegressionOptions{}) const;
+
+	private:
+		struct Combination
+		{
+			std::string name;
+			// Indices into values_
+			std::vector<std::uint32_t> values;
+		};
+
+		void replay(const std::string& payload);
+		std::uint32_t runIndex(const std::string& run) const;
+		const std::vector<double>* find(std::uint32_t run, std::uint32_t combination) const;
+
+		mutable std::mutex mutex_;
+		std::vector<std::string> runs_;
+		std::unordered_map<std::string, std::uint32_t> runIndices_;
+		std::vector<Combination> combinations_;
+		std::unordered_map<std::string, std::uint32_t> combinationIndices_;
+		// Distinct (parameter, value string) pairs of all combinations
+		std::vector<std::pair<std::string, std::string>> values_;
+		// Keyed by parameter + '\0' + value
+		std::unordered_map<std::string, std::uint32_t> valueIndices_;
+		// Samples by run, then by combination index
+		std::vector<std::vector<std::vector<double>>> samples_;
+		// Declared last, its constructor replays into the members above
+		RecordLog log_;
+	};
+
+} // Namespace parameterCombinator
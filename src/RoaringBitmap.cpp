@@ -0,0 +1,319 @@
+#include "RoaringBitmap.h"
+#include <algorithm>
+#include <iterator>
+
+namespace parameterCombinator
+{
+	std::vector<std::uint64_t> RoaringBitmap::Container::toBits() const
+	{
+		if (isBitmap())
+		{
+			return bits;
+		}
+		std::vector<std::uint64_t> result(bitmapWords, 0);
+		for (std::uint16_t low : array)
+		{
+			result[low / 64] |= std::uint64_t(1) << (low % 64);
+		}
+		return result;
+	}
+
+	RoaringBitmap::Container RoaringBitmap::Container::fromBits(std::uint16_t key, std::vector<std::uint64_t> bits)
+	{
+		Container container;
+		container.key = key;
+		for (std::uint64_t word : bits)
+		{
+			container.cardinality += popCount(word);
+		}
+		if (container.cardinality > arrayLimit)
+		{
+			container.bits = std::move(bits);
+			return container;
+		}
+		container.array.reserve(container.cardinality);
+		for (std::size_t word = 0; word < bits.size(); ++word)
+		{
+			std::uint64_t remaining = bits[word];
+			while (remaining)
+			{
+				container.array.push_back(static_cast<std::uint16_t>(word * 64 + lowestBit(remaining)));
+				remaining &= remaining - 1;
+			}
+		}
+		return container;
+	}
+
+	RoaringBitmap RoaringBitmap::range(std::uint32_t begin, std::uint32_t end)
+	{
+		RoaringBitmap bitmap;
+		while (begin < end)
+		{
+			std::uint16_t key = static_cast<std::uint16_t>(begin >> 16);
+			std::uint32_t containerEnd = std::min<std::uint64_t>(end, (static_cast<std::uint64_t>(key) + 1) << 16);
+			std::vector<std::uint64_t> bits(bitmapWords, 0);
+			for (std::uint32_t row = begin; row < containerEnd; ++row)
+			{
+				bits[(row & 0xFFFF) / 64] |= std::uint64_t(1) << (row % 64);
+			}
+			bitmap.containers_.push_back(Container::fromBits(key, std::move(bits)));
+			begin = containerEnd;
+		}
+		return bitmap;
+	}
+
+	RoaringBitmap::Container* RoaringBitmap::findContainer(std::uint16_t key)
+	{
+		auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+			[](const Container& container, std::uint16_t value) { return container.key < value; });
+		return it != containers_.end() && it->key == key ? &*it : nullptr;
+	}
+
+	const RoaringBitmap::Container* RoaringBitmap::findContainer(std::uint16_t key) const
+	{
+		return const_cast<RoaringBitmap*>(this)->findContainer(key);
+	}
+
+	void RoaringBitmap::add(std::uint32_t row)
+	{
+		std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+		std::uint16_t low = static_cast<std::uint16_t>(row & 0xFFFF);
+		Container* container = nullptr;
+		if (!containers_.empty() && containers_.back().key == key)
+		{
+			container = &containers_.back();
+		}
+		else if (containers_.empty() || containers_.back().key < key)
+		{
+			containers_.emplace_back();
+			containers_.back().key = key;
+			container = &containers_.back();
+		}
+		else
+		{
+			container = findContainer(key);
+			if (!container)
+			{
+				auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+					[](const Container& entry, std::uint16_t value) { return entry.key < value; });
+				container = &*containers_.insert(it, Container{});
+				container->key = key;
+			}
+		}
+
+		if (container->isBitmap())
+		{
+			std::uint64_t& word = container->bits[low / 64];
+			std::uint64_t mask = std::uint64_t(1) << (low % 64);
+			container->cardinality += (word & mask) ? 0 : 1;
+			word |= mask;
+			return;
+		}
+		auto position = container->array.empty() || container->array.back() < low
+			? container->array.end()
+			: std::lower_bound(container->array.begin(), container->array.end(), low);
+		if (position != container->array.end() && *position == low)
+		{
+			return;
+		}
+		container->array.insert(position, low);
+		++container->cardinality;
+		if (container->cardinality > arrayLimit)
+		{
+			container->bits = container->toBits();
+			container->array.clear();
+			container->array.shrink_to_fit();
+		}
+	}
+
+	bool RoaringBitmap::contains(std::uint32_t row) const
+	{
+		const Container* container = findContainer(static_cast<std::uint16_t>(row >> 16));
+		if (!container)
+		{
+			return false;
+		}
+		std::uint16_t low = static_cast<std::uint16_t>(row & 0xFFFF);
+		if (container->isBitmap())
+		{
+			return (container->bits[low / 64] >> (low % 64)) & 1;
+		}
+		return std::binary_search(container->array.begin(), container->array.end(), low);
+	}
+
+	std::uint64_t RoaringBitmap::cardinality() const
+	{
+		std::uint64_t total = 0;
+		for (auto& container : containers_)
+		{
+			total += container.cardinality;
+		}
+		return total;
+	}
+
+	bool RoaringBitmap::empty() const
+	{
+		return containers_.empty();
+	}
+
+	std::size_t RoaringBitmap::bytes() const
+	{
+		std::size_t total = containers_.capacity() * sizeof(Container);
+		for (auto& container : containers_)
+		{
+			total += container.array.capacity() * sizeof(std::uint16_t) + container.bits.capacity() * sizeof(std::uint64_t);
+		}
+		return total;
+	}
+
+	std::vector<std::uint32_t> RoaringBitmap::toVector() const
+	{
+		std::vector<std::uint32_t> rows;
+		rows.reserve(static_cast<std::size_t>(cardinality()));
+		forEach([&](std::uint32_t row) { rows.push_back(row); });
+		return rows;
+	}
+
+	RoaringBitmap::Container RoaringBitmap::combine(const Container& lhs, const Container& rhs, Operation operation)
+	{
+		if (!lhs.isBitmap() && !rhs.isBitmap())
+		{
+			Container result;
+			result.key = lhs.key;
+			auto out = std::back_inserter(result.array);
+			switch (operation)
+			{
+			case Operation::And:
+				std::set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), out);
+				break;
+			case Operation::Or:
+				std::set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), out);
+				break;
+			case Operation::AndNot:
+				std::set_difference(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), out);
+				break;
+			}
+			result.cardinality = static_cast<std::uint32_t>(result.array.size());
+			if (result.cardinality > arrayLimit)
+			{
+				return Container::fromBits(result.key, result.toBits());
+			}
+			return result;
+		}
+
+		std::vector<std::uint64_t> bits = lhs.toBits();
+		std::vector<std::uint64_t> other = rhs.toBits();
+		for (std::size_t word = 0; word < bitmapWords; ++word)
+		{
+			switch (operation)
+			{
+			case Operation::And:
+				bits[word] &= other[word];
+				break;
+			case Operation::Or:
+				bits[word] |= other[word];
+				break;
+			case Operation::AndNot:
+				bits[word] &= ~other[word];
+				break;
+			}
+		}
+		return Container::fromBits(lhs.key, std::move(bits));
+	}
+
+	RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other)
+	{
+		std::vector<Container> result;
+		auto rhs = other.containers_.begin();
+		for (auto& container : containers_)
+		{
+			while (rhs != other.containers_.end() && rhs->key < container.key)
+			{
+				++rhs;
+			}
+			if (rhs == other.containers_.end())
+			{
+				break;
+			}
+			if (rhs->key == container.key)
+			{
+				Container combined = combine(container, *rhs, Operation::And);
+				if (combined.cardinality)
+				{
+					result.push_back(std::move(combined));
+				}
+			}
+		}
+		containers_ = std::move(result);
+		return *this;
+	}
+
+	RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other)
+	{
+		std::vector<Container> result;
+		result.reserve(containers_.size() + other.containers_.size());
+		auto lhs = containers_.begin();
+		auto rhs = other.containers_.begin();
+		while (lhs != containers_.end() || rhs != other.containers_.end())
+		{
+			if (rhs == other.containers_.end() || (lhs != containers_.end() && lhs->key < rhs->key))
+			{
+				result.push_back(std::move(*lhs++));
+			}
+			else if (lhs == containers_.end() || rhs->key < lhs->key)
+			{
+				result.push_back(*rhs++);
+			}
+			else
+			{
+				result.push_back(combine(*lhs++, *rhs++, Operation::Or));
+			}
+		}
+		containers_ = std::move(result);
+		return *this;
+	}
+
+	RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap& other)
+	{
+		std::vector<Container> result;
+		auto rhs = other.containers_.begin();
+		for (auto& container : containers_)
+		{
+			while (rhs != other.containers_.end() && rhs->key < container.key)
+			{
+				++rhs;
+			}
+			if (rhs == other.containers_.end() || rhs->key != container.key)
+			{
+				result.push_back(std::move(container));
+				continue;
+			}
+			Container combined = combine(container, *rhs, Operation::AndNot);
+			if (combined.cardinality)
+			{
+				result.push_back(std::move(combined));
+			}
+		}
+		containers_ = std::move(result);
+		return *this;
+	}
+
+	bool RoaringBitmap::operator==(const RoaringBitmap& other) const
+	{
+		if (containers_.size() != other.containers_.size())
+		{
+			return false;
+		}
+		for (std::size_t i = 0; i < containers_.size(); ++i)
+		{
+			const Container& lhs = containers_[i];
+			const Container& rhs = other.containers_[i];
+			if (lhs.key != rhs.key || lhs.cardinality != rhs.cardinality || lhs.array != rhs.array || lhs.bits != rhs.bits)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace parameterCombinator
+{
+	// Compressed set of 32 bit row numbers in the style of roaring bitmaps. Rows are split by their high 16 bits into
+	// containers holding the low 16 bits either as a sorted array (up to 4096 rows) or as a 65536 bit bitmap, so
+	// sparse and dense sets both stay small and set operations work container by container.
+	class RoaringBitmap
+	{
+	public:
+		// Bitmap holding the rows [begin, end)
+		static RoaringBitmap range(std::uint32_t begin, std::uint32_t end);
+
+		// Adding rows in increasing order appends to the last container
+		void add(std::uint32_t row);
+		bool contains(std::uint32_t row) const;
+		std::uint64_t cardinality() const;
+		bool empty() const;
+		// Memory held by the containers
+		std::size_t bytes() const;
+		std::vector<std::uint32_t> toVector() const;
+
+		RoaringBitmap& operator&=(const RoaringBitmap& other);
+		RoaringBitmap& operator|=(const RoaringBitmap& other);
+		// Rows of this bitmap that are not in 'other'
+		RoaringBitmap& operator-=(const RoaringBitmap& other);
+		friend RoaringBitmap operator&(RoaringBitmap lhs, const RoaringBitmap& rhs) { return lhs &= rhs; }
+		friend RoaringBitmap operator|(RoaringBitmap lhs, const RoaringBitmap& rhs) { return lhs |= rhs; }
+		friend RoaringBitmap operator-(RoaringBitmap lhs, const RoaringBitmap& rhs) { return lhs -= rhs; }
+		bool operator==(const RoaringBitmap& other) const;
+
+		// Calls 'callback' with every row in increasing order
+		template<typename Callback>
+		void forEach(Callback&& callback) const
+		{
+			for (auto& container : containers_)
+			{
+				std::uint32_t high = static_cast<std::uint32_t>(container.key) << 16;
+				if (!container.isBitmap())
+				{
+					for (std::uint16_t low : container.array)
+					{
+						callback(high | low);
+					}
+					continue;
+				}
+				for (std::size_t word = 0; word < container.bits.size(); ++word)
+				{
+					std::uint64_t bits = container.bits[word];
+					while (bits)
+					{
+						unsigned bit = lowestBit(bits);
+						callback(high | static_cast<std::uint32_t>(word * 64 + bit));
+						bits &= bits - 1;
+					}
+				}
+			}
+		}
+
+	private:
+		struct Container
+		{
+			std::uint16_t key = 0;
+			std::uint32_t cardinality = 0;
+			// Sorted low bits while the container is sparse
+			std::vector<std::uint16_t> array;
+			// 1024 words once it holds more than arrayLimit rows
+			std::vector<std::uint64_t> bits;
+
+			bool isBitmap() const { return !bits.empty(); }
+			std::vector<std::uint64_t> toBits() const;
+			// Picks the smaller representation for 'bits'
+			static Container fromBits(std::uint16_t key, std::vector<std::uint64_t> bits);
+		};
+		static constexpr std::size_t arrayLimit = 4096;
+		static constexpr std::size_t bitmapWords = 1024;
+
+		// Set bits of 'word', and the index of its lowest set bit ('word' must not be 0)
+		static unsigned popCount(std::uint64_t word);
+		static unsigned lowestBit(std::uint64_t word);
+
+		enum class Operation { And, Or, AndNot };
+		static Container combine(const Container& lhs, const Container& rhs, Operation operation);
+		Container* findContainer(std::uint16_t key);
+		const Container* findContainer(std::uint16_t key) const;
+
+		// Sorted by key
+		std::vector<Container> containers_;
+	};
+
+	inline unsigned RoaringBitmap::popCount(std::uint64_t word)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return static_cast<unsigned>(__popcnt64(word));
+#elif defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+		unsigned count = 0;
+		for (; word; word &= word - 1)
+		{
+			++count;
+		}
+		return count;
+#endif
+	}
+
+	inline unsigned RoaringBitmap::lowestBit(std::uint64_t word)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return static_cast<unsigned>(index);
+#elif defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+		unsigned index = 0;
+		for (; !(word & 1); word >>= 1)
+		{
+			++index;
+		}
+		return index;
+#endif
+	}
+
+} // Namespace parameterCombinator
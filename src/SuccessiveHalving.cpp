@@ -0,0 +1,178 @@
+#include "SuccessiveHalving.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace parameterCombinator
+{
+	SuccessiveHalving::SuccessiveHalving(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+		const HalvingOptions& options)
+		: dontCares_(dontCares), options_(options)
+	{
+		if (!(options_.keepFraction > 0.0 && options_.keepFraction < 1.0))
+		{
+			throw std::invalid_argument("Keep fraction must be between 0 and 1.");
+		}
+		for (auto& [name, values] : paramCombs)
+		{
+			survivors_[name] = std::make_shared<std::vector<Parameter>>(values.begin(), values.end());
+		}
+	}
+
+	bool SuccessiveHalving::isBetter(double score, double reference) const
+	{
+		return options_.minimize ? score < reference : score > reference;
+	}
+
+	HalvingResult SuccessiveHalving::run(const scorer_t& scorer)
+	{
+		HalvingResult result;
+		// Scores by combination name, kept across rounds so no combination is evaluated twice
+		std::unordered_map<std::string, double> scores;
+		std::mt19937_64 random(options_.seed);
+		std::size_t roundBudget = options_.roundBudget;
+		bool hasBest = false;
+
+		auto evaluate = [&](const parameterInstanceMap_t& paramInstance, const std::string& name)
+		{
+			double score = scorer(paramInstance);
+			scores.emplace(name, score);
+			++result.evaluations;
+			if (!hasBest || isBetter(score, result.bestScore))
+			{
+				result.best = paramInstance;
+				result.bestScore = score;
+				hasBest = true;
+			}
+		};
+
+		while (true)
+		{
+			parameterCombinations_t paramCombs;
+			for (auto& [name, values] : survivors_)
+			{
+				paramCombs[name] = ParametersVec(values->size(), [values](std::size_t idx) { return (*values)[idx]; });
+			}
+			ParameterCombinator paramCombinator;
+			paramCombinator.combine(paramCombs, dontCares_);
+			auto paramSet = paramCombinator.getParameterInstanceSet();
+
+			HalvingRound round;
+			round.combinations = paramSet->size();
+
+			std::vector<std::pair<const parameterInstanceMap_t*, std::string>> pending;
+			for (auto& paramInstance : *paramSet)
+			{
+				std::string name = ParameterCombinator::generateCombinationName(paramInstance);
+				if (!scores.count(name))
+				{
+					pending.emplace_back(&paramInstance, std::move(name));
+				}
+			}
+			bool lastRound = !roundBudget || pending.size() <= roundBudget;
+			if (!lastRound)
+			{
+				std::shuffle(pending.begin(), pending.end(), random);
+				pending.resize(roundBudget);
+			}
+			for (auto& [paramInstance, name] : pending)
+			{
+				evaluate(*paramInstance, name);
+			}
+			round.evaluations = pending.size();
+
+			round.eliminated = eliminate(*paramSet, scores);
+			bool eliminated = !round.eliminated.empty();
+			result.rounds.push_back(std::move(round));
+			// A fully evaluated sub-product that can not shrink any more holds the best combination
+			if (!eliminated && lastRound)
+			{
+				break;
+			}
+			if (!eliminated)
+			{
+				// Nothing left to race on: finish the remaining sub-product
+				roundBudget = 0;
+			}
+		}
+
+		for (auto& [name, values] : survivors_)
+		{
+			result.survivors[name] = ParametersVec(values->size(), [values](std::size_t idx) { return (*values)[idx]; });
+		}
+		return result;
+	}
+
+	std::vector<std::string> SuccessiveHalving::eliminate(const parameterInstanceSet_t& paramSet,
+		const std::unordered_map<std::string, double>& scores)
+	{
+		// Mean score of every value over the scored combinations of the current sub-product
+		std::map<std::string, std::map<Parameter, std::pair<double, std::size_t>>> valueScores;
+		for (auto& paramInstance : paramSet)
+		{
+			auto score = scores.find(ParameterCombinator::generateCombinationName(paramInstance));
+			if (score == scores.end())
+			{
+				continue;
+			}
+			for (auto& [name, value] : paramInstance)
+			{
+				auto& [sum, count] = valueScores[name][value];
+				sum += score->second;
+				++count;
+			}
+		}
+
+		std::vector<std::string> eliminated;
+		for (auto& [name, values] : survivors_)
+		{
+			auto observed = valueScores.find(name);
+			if (values->size() <= options_.minValues || observed == valueScores.end())
+			{
+				continue;
+			}
+			// Values without observations can not be judged yet and stay in the race
+			std::vector<std::pair<double, Parameter>> ranked;
+			for (auto& value : *values)
+			{
+				auto valueScore = observed->second.find(value);
+				if (valueScore != observed->second.end())
+				{
+					ranked.emplace_back(valueScore->second.first / valueScore->second.second, value);
+				}
+			}
+			std::size_t unobserved = values->size() - ranked.size();
+			std::size_t keep = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(ranked.size() * options_.keepFraction)));
+			if (options_.minValues > unobserved)
+			{
+				keep = std::max(keep, options_.minValues - unobserved);
+			}
+			if (keep >= ranked.size())
+			{
+				continue;
+			}
+			std::stable_sort(ranked.begin(), ranked.end(), [&](const auto& lhs, const auto& rhs)
+			{
+				return isBetter(lhs.first, rhs.first);
+			});
+
+			auto survivors = std::make_shared<std::vector<Parameter>>();
+			for (auto& value : *values)
+			{
+				auto loser = std::find_if(ranked.begin() + keep, ranked.end(),
+					[&](const auto& entry) { return entry.second == value; });
+				if (loser == ranked.end())
+				{
+					survivors->push_back(value);
+				}
+				else
+				{
+					eliminated.push_back(name + "=" + value->toString());
+				}
+			}
+			values = std::move(survivors);
+		}
+		return eliminated;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,67 @@
+#pragma once
+#include "ParameterCombinator.h"
+#include <cstdint>
+
+namespace parameterCombinator
+{
+	struct HalvingOptions
+	{
+		// Fraction of the observed values of every parameter kept after each round
+		double keepFraction = 0.5;
+		// New evaluations per round, sampled from the surviving sub-product. 0 evaluates the whole sub-product.
+		std::size_t roundBudget = 0;
+		// Parameters are not reduced below this many values
+		std::size_t minValues = 1;
+		// Lower scores are better unless false
+		bool minimize = true;
+		// Seed of the sampling of each round
+		std::uint64_t seed = 0;
+	};
+
+	struct HalvingRound
+	{
+		// Size of the surviving sub-product at the start of the round
+		std::size_t combinations = 0;
+		std::size_t evaluations = 0;
+		// Values removed in this round, keyed "parameter=value"
+		std::vector<std::string> eliminated;
+	};
+
+	struct HalvingResult
+	{
+		parameterInstanceMap_t best;
+		double bestScore = 0.0;
+		// Total number of scorer calls. A combination is never scored twice.
+		std::size_t evaluations = 0;
+		std::vector<HalvingRound> rounds;
+		// Values of every parameter still in the race at the end
+		parameterCombinations_t survivors;
+	};
+
+	// Adaptive sweep for tuning. Every round scores a sample of the surviving sub-product, ranks the values of each
+	// parameter by the mean score of the combinations holding them and eliminates the worst ones. Only the product
+	// of the surviving values is combined again, so bad values stop costing evaluations early. Once no parameter can
+	// be reduced any further the remaining sub-product is evaluated completely.
+	class SuccessiveHalving
+	{
+	public:
+		using scorer_t = std::function<double(const parameterInstanceMap_t&)>;
+
+		SuccessiveHalving(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+			const HalvingOptions& options = HalvingOptions{});
+		HalvingResult run(const scorer_t& scorer);
+
+	private:
+		bool isBetter(double score, double reference) const;
+		// Removes the worst values of every parameter given the scores of the current sub-product.
+		// Returns the removed values.
+		std::vector<std::string> eliminate(const parameterInstanceSet_t& paramSet,
+			const std::unordered_map<std::string, double>& scores);
+
+		// Surviving values of every parameter
+		std::map<std::string, std::shared_ptr<std::vector<Parameter>>> survivors_;
+		dontCares_t dontCares_;
+		HalvingOptions options_;
+	};
+
+} // Namespace parameterCombinator
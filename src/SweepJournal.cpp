@@ -0,0 +1,91 @@
+#include "SweepJournal.h"
+
+namespace parameterCombinator
+{
+	// Records hold the combination id (8 bytes, little endian) followed by the result
+	static std::string encodeEntry(std::uint64_t combinationId, const std::string& result)
+	{
+		std::string payload;
+		payload.reserve(8 + result.size());
+		for (std::size_t i = 0; i < 8; ++i)
+		{
+			payload.push_back(static_cast<char>((combinationId >> (8 * i)) & 0xFF));
+		}
+		return payload + result;
+	}
+
+	SweepJournal::SweepJournal(const std::string& path)
+		: log_(path, [this](const std::string& payload)
+		{
+			if (payload.size() < 8)
+			{
+				return;
+			}
+			std::uint64_t combinationId = 0;
+			for (std::size_t i = 0; i < 8; ++i)
+			{
+				combinationId |= static_cast<std::uint64_t>(static_cast<unsigned char>(payload[i])) << (8 * i);
+			}
+			results_[combinationId] = payload.substr(8);
+		})
+	{
+	}
+
+	bool SweepJournal::isDone(const parameterInstanceMap_t& paramInstance) const
+	{
+		return isDone(ParameterCombinator::combinationId(paramInstance));
+	}
+
+	bool SweepJournal::isDone(std::uint64_t combinationId) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return results_.count(combinationId) != 0;
+	}
+
+	std::optional<std::string> SweepJournal::result(const parameterInstanceMap_t& paramInstance) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto entry = results_.find(ParameterCombinator::combinationId(paramInstance));
+		if (entry == results_.end())
+		{
+			return std::nullopt;
+		}
+		return entry->second;
+	}
+
+	void SweepJournal::record(const parameterInstanceMap_t& paramInstance, const std::string& result)
+	{
+		std::uint64_t combinationId = ParameterCombinator::combinationId(paramInstance);
+		std::string payload = encodeEntry(combinationId, result);
+		std::lock_guard<std::mutex> lock(mutex_);
+		log_.append(payload);
+		results_[combinationId] = result;
+	}
+
+	std::size_t SweepJournal::size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return results_.size();
+	}
+
+	std::size_t SweepJournal::truncatedBytes() const
+	{
+		return log_.truncatedBytes();
+	}
+
+	std::size_t SweepJournal::run(const parameterInstanceSet_t& paramSet, const evaluator_t& evaluator)
+	{
+		std::size_t evaluated = 0;
+		for (auto& paramInstance : paramSet)
+		{
+			if (isDone(paramInstance))
+			{
+				continue;
+			}
+			record(paramInstance, evaluator(paramInstance));
+			++evaluated;
+		}
+		return evaluated;
+	}
+
+} // Namespace parameterCombinator
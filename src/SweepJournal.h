@@ -0,0 +1,39 @@
+#pragma once
+#include "ParameterCombinator.h"
+#include "RecordLog.h"
+#include <mutex>
+
+namespace parameterCombinator
+{
+	// Crash-safe record of the finished combinations of a sweep and their results, keyed by
+	// ParameterCombinator::combinationId(). Reopening the journal of an interrupted sweep restores what was done, so
+	// a resumed run only evaluates the rest.
+	class SweepJournal
+	{
+	public:
+		using evaluator_t = std::function<std::string(const parameterInstanceMap_t&)>;
+
+		explicit SweepJournal(const std::string& path);
+
+		bool isDone(const parameterInstanceMap_t& paramInstance) const;
+		bool isDone(std::uint64_t combinationId) const;
+		// Result recorded for a finished combination
+		std::optional<std::string> result(const parameterInstanceMap_t& paramInstance) const;
+		// Records a finished combination. Safe to call from several threads.
+		void record(const parameterInstanceMap_t& paramInstance, const std::string& result);
+		// Number of finished combinations
+		std::size_t size() const;
+		// Bytes of torn records dropped when the journal was opened
+		std::size_t truncatedBytes() const;
+
+		// Evaluates and records every combination of 'paramSet' that is not done yet. Returns the number evaluated.
+		std::size_t run(const parameterInstanceSet_t& paramSet, const evaluator_t& evaluator);
+
+	private:
+		mutable std::mutex mutex_;
+		std::unordered_map<std::uint64_t, std::string> results_;
+		// Declared after results_, which its constructor fills
+		RecordLog log_;
+	};
+
+} // Namespace parameterCombinator
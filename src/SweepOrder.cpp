@@ -0,0 +1,471 @@
+#include "SweepOrder.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// A value or value pair: how many combinations not ordered yet hold it, and the last round that covered it
+		struct CoverageFeature
+		{
+			std::uint32_t remaining = 0;
+			std::uint32_t coveredRound = 0;
+		};
+
+		// Features of the unordered pairs of value ids. A matrix while there are few enough values, a hash map
+		// otherwise.
+		class PairFeatures
+		{
+		public:
+			explicit PairFeatures(std::uint32_t values)
+				: values_(values)
+			{
+				if (isDense())
+				{
+					dense_.resize(static_cast<std::size_t>(values_) * values_);
+				}
+			}
+			CoverageFeature& operator()(std::uint32_t lhs, std::uint32_t rhs)
+			{
+				std::uint32_t low = std::min(lhs, rhs);
+				std::uint32_t high = std::max(lhs, rhs);
+				if (isDense())
+				{
+					return dense_[static_cast<std::size_t>(low) * values_ + high];
+				}
+				return hashed_[(static_cast<std::uint64_t>(low) << 32) | high];
+			}
+		private:
+			static constexpr std::uint32_t denseLimit = 1024;
+			bool isDense() const
+			{
+				return values_ <= denseLimit;
+			}
+
+			std::uint32_t values_;
+			std::vector<CoverageFeature> dense_;
+			std::unordered_map<std::uint64_t, CoverageFeature> hashed_;
+		};
+	}
+
+	std::size_t SweepOrder::grayCode(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+		const stepCallback_t& callback)
+	{
+		std::vector<std::string> keyOrder;
+		std::vector<const ParametersVec*> sequences;
+		for (auto& param : paramCombs)
+		{
+			if (!param.second.size())
+			{
+				return 0;
+			}
+			keyOrder.push_back(param.first);
+			sequences.push_back(&param.second);
+		}
+		if (sequences.empty())
+		{
+			return 0;
+		}
+
+		CompiledDontCares rules(dontCares, paramCombs);
+		ParameterMask allPresent(rules.words());
+		for (std::size_t i = 0; i < keyOrder.size(); ++i)
+		{
+			allPresent.set(i);
+		}
+		parameterInstanceSet_t visited;
+		parameterInstanceMap_t previous;
+		std::size_t count = 0;
+		std::vector<std::size_t> indices(sequences.size(), 0);
+
+		auto visit = [&]()
+		{
+			ParameterMask present = allPresent;
+			rules.apply(indices.data(), present.data());
+			parameterInstanceMap_t paramInstance;
+			for (std::size_t i = 0; i < indices.size(); ++i)
+			{
+				if (present.test(i))
+				{
+					paramInstance.emplace_hint(paramInstance.end(), keyOrder[i], (*sequences[i])[indices[i]]);
+				}
+			}
+			if (!visited.insert(paramInstance).second)
+			{
+				return;
+			}
+			callback(paramInstance, changedParameters(previous, paramInstance));
+			previous = std::move(paramInstance);
+			++count;
+		};
+
+		// Loopless reflected mixed-radix Gray code (Knuth, TAOCP 7.2.1.1, algorithm H). Digit 0 is the last
+		// parameter. Parameters with a single value never change and are left out of the digits.
+		std::vector<std::size_t> digits;
+		for (std::size_t i = sequences.size(); i-- > 0;)
+		{
+			if (sequences[i]->size() > 1)
+			{
+				digits.push_back(i);
+			}
+		}
+		std::size_t n = digits.size();
+		std::vector<std::size_t> focus(n + 1);
+		std::vector<bool> ascending(n, true);
+		for (std::size_t j = 0; j <= n; ++j)
+		{
+			focus[j] = j;
+		}
+		while (true)
+		{
+			visit();
+			std::size_t j = focus[0];
+			focus[0] = 0;
+			if (j == n)
+			{
+				break;
+			}
+			std::size_t& index = indices[digits[j]];
+			index = ascending[j] ? index + 1 : index - 1;
+			if (index == 0 || index == sequences[digits[j]]->size() - 1)
+			{
+				ascending[j] = !ascending[j];
+				focus[j] = focus[j + 1];
+				focus[j + 1] = j + 1;
+			}
+		}
+		return count;
+	}
+
+	std::vector<std::string> SweepOrder::nestingOrder(const parameterCombinations_t& paramCombs, const parameterSetups_t& setups)
+	{
+		std::vector<std::pair<double, std::string>> ranked;
+		for (auto& [name, values] : paramCombs)
+		{
+			auto setup = setups.find(name);
+			double cost = setup == setups.end() ? 0.0 : setup->second.switchCost;
+			double n = static_cast<double>(values.size());
+			// A single value never switches, so it can go anywhere. Outermost keeps it out of the way.
+			double rank = n > 1 ? cost * n / (n - 1) : std::numeric_limits<double>::infinity();
+			ranked.emplace_back(rank, name);
+		}
+		// Stable so equally ranked parameters keep name order
+		std::stable_sort(ranked.begin(), ranked.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+		std::vector<std::string> order;
+		for (auto& entry : ranked)
+		{
+			order.push_back(entry.second);
+		}
+		return order;
+	}
+
+	double SweepOrder::nestingCost(const parameterCombinations_t& paramCombs, const parameterSetups_t& setups,
+		const std::vector<std::string>& order)
+	{
+		double cost = 0.0;
+		double prefixes = 1.0;
+		for (auto& name : order)
+		{
+			prefixes *= static_cast<double>(paramCombs.at(name).size());
+			auto setup = setups.find(name);
+			if (setup != setups.end())
+			{
+				cost += setup->second.switchCost * prefixes;
+			}
+		}
+		return cost;
+	}
+
+	std::size_t SweepOrder::nested(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+		const parameterSetups_t& setups, const std::function<void(const parameterInstanceMap_t&)>& callback)
+	{
+		std::vector<std::string> order = nestingOrder(paramCombs, setups);
+		std::vector<const ParametersVec*> sequences;
+		for (auto& name : order)
+		{
+			sequences.push_back(&paramCombs.at(name));
+			if (!sequences.back()->size())
+			{
+				return 0;
+			}
+		}
+		if (sequences.empty())
+		{
+			return 0;
+		}
+		// Rules work on the parameters in name order
+		std::vector<std::size_t> bitOf(order.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			bitOf[i] = std::distance(paramCombs.begin(), paramCombs.find(order[i]));
+		}
+
+		CompiledDontCares rules(dontCares, paramCombs);
+		ParameterMask allPresent(rules.words());
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			allPresent.set(i);
+		}
+		parameterInstanceSet_t visited;
+		// Values currently set up, in nesting order
+		std::vector<std::optional<Parameter>> active(order.size());
+		std::vector<std::size_t> indices(order.size(), 0);
+		std::vector<std::size_t> ruleIndices(order.size(), 0);
+		std::size_t count = 0;
+
+		auto hook = [&](std::size_t position, const Parameter& value, bool isSetup)
+		{
+			auto setup = setups.find(order[position]);
+			if (setup == setups.end())
+			{
+				return;
+			}
+			auto& function = isSetup ? setup->second.setup : setup->second.teardown;
+			if (function)
+			{
+				function(order[position], value);
+			}
+		};
+
+		while (true)
+		{
+			for (std::size_t i = 0; i < order.size(); ++i)
+			{
+				ruleIndices[bitOf[i]] = indices[i];
+			}
+			ParameterMask present = allPresent;
+			rules.apply(ruleIndices.data(), present.data());
+			parameterInstanceMap_t paramInstance;
+			for (std::size_t i = 0; i < order.size(); ++i)
+			{
+				if (present.test(bitOf[i]))
+				{
+					paramInstance.emplace(order[i], (*sequences[i])[indices[i]]);
+				}
+			}
+
+			if (visited.insert(paramInstance).second)
+			{
+				// A value changing invalidates the setups nested inside it
+				std::size_t firstChanged = order.size();
+				for (std::size_t i = 0; i < order.size(); ++i)
+				{
+					auto value = paramInstance.find(order[i]);
+					bool same = value == paramInstance.end() ? !active[i] : active[i] && *active[i] == value->second;
+					if (!same)
+					{
+						firstChanged = i;
+						break;
+					}
+				}
+				for (std::size_t i = order.size(); i-- > firstChanged;)
+				{
+					if (active[i])
+					{
+						hook(i, *active[i], false);
+						active[i].reset();
+					}
+				}
+				for (std::size_t i = firstChanged; i < order.size(); ++i)
+				{
+					auto value = paramInstance.find(order[i]);
+					if (value != paramInstance.end())
+					{
+						active[i] = value->second;
+						hook(i, value->second, true);
+					}
+				}
+				callback(paramInstance);
+				++count;
+			}
+
+			// Odometer with the innermost parameter last
+			bool done = true;
+			for (std::size_t digit = indices.size(); digit-- > 0;)
+			{
+				if (++indices[digit] < sequences[digit]->size())
+				{
+					done = false;
+					break;
+				}
+				indices[digit] = 0;
+			}
+			if (done)
+			{
+				break;
+			}
+		}
+
+		for (std::size_t i = order.size(); i-- > 0;)
+		{
+			if (active[i])
+			{
+				hook(i, *active[i], false);
+			}
+		}
+		return count;
+	}
+
+	std::vector<const parameterInstanceMap_t*> SweepOrder::coverageOrder(const parameterInstanceSet_t& paramSet)
+	{
+		// Every (parameter, value) gets an id, and every combination the list of ids it holds
+		std::map<std::string, std::map<Parameter, std::uint32_t>> valueIds;
+		std::vector<const parameterInstanceMap_t*> instances;
+		std::vector<std::uint32_t> ids;
+		std::vector<std::size_t> idsBegin;
+		std::uint32_t valueCount = 0;
+		std::uint64_t maxHeld = 0;
+		for (auto& paramInstance : paramSet)
+		{
+			instances.push_back(&paramInstance);
+			idsBegin.push_back(ids.size());
+			for (auto& [name, value] : paramInstance)
+			{
+				auto [id, isNew] = valueIds[name].try_emplace(value, valueCount);
+				valueCount += isNew ? 1 : 0;
+				ids.push_back(id->second);
+			}
+			maxHeld = std::max<std::uint64_t>(maxHeld, paramInstance.size());
+		}
+		idsBegin.push_back(ids.size());
+
+		std::vector<CoverageFeature> values(valueCount);
+		PairFeatures pairs(valueCount);
+		// Features held by combinations not ordered yet, and those of them the current round has not covered
+		std::size_t available = 0;
+		std::size_t uncovered = 0;
+		std::uint32_t round = 0;
+		auto forEachFeature = [&](std::size_t instance, auto&& callback)
+		{
+			for (std::size_t first = idsBegin[instance]; first < idsBegin[instance + 1]; ++first)
+			{
+				callback(values[ids[first]], true);
+				for (std::size_t second = first + 1; second < idsBegin[instance + 1]; ++second)
+				{
+					callback(pairs(ids[first], ids[second]), false);
+				}
+			}
+		};
+		for (std::size_t instance = 0; instance < instances.size(); ++instance)
+		{
+			forEachFeature(instance, [&](CoverageFeature& feature, bool)
+			{
+				available += feature.remaining++ == 0 ? 1 : 0;
+			});
+		}
+
+		// A new value outweighs any number of new pairs
+		const std::uint64_t maxPairs = maxHeld * (maxHeld - std::min<std::uint64_t>(maxHeld, 1)) / 2;
+		const std::uint64_t valueWeight = maxPairs + 1;
+		auto score = [&](std::size_t instance)
+		{
+			std::uint64_t total = 0;
+			forEachFeature(instance, [&](CoverageFeature& feature, bool isValue)
+			{
+				total += feature.coveredRound == round ? 0 : (isValue ? valueWeight : 1);
+			});
+			return total;
+		};
+
+		// Lazy greedy: covering more can only lower a score, so a popped combination whose recomputed score still
+		// matches its queued one is the best. Scores are small, so the queue is an array of buckets. Ties go to the
+		// earlier combination of the set.
+		std::vector<std::vector<std::size_t>> buckets(maxHeld * valueWeight + maxPairs + 1);
+		std::vector<const parameterInstanceMap_t*> order;
+		order.reserve(instances.size());
+		std::vector<bool> taken(instances.size(), false);
+		while (order.size() < instances.size())
+		{
+			// Once every value and pair left is covered, coverage starts over so later prefixes spread out as well
+			++round;
+			uncovered = available;
+			if (!uncovered)
+			{
+				// Only combinations without parameters are left
+				for (std::size_t instance = 0; instance < instances.size(); ++instance)
+				{
+					if (!taken[instance])
+					{
+						order.push_back(instances[instance]);
+					}
+				}
+				break;
+			}
+			// Nothing is covered at the start of a round
+			for (std::size_t instance = instances.size(); instance-- > 0;)
+			{
+				if (!taken[instance])
+				{
+					std::uint64_t held = idsBegin[instance + 1] - idsBegin[instance];
+					buckets[held * valueWeight + held * (held - std::min<std::uint64_t>(held, 1)) / 2].push_back(instance);
+				}
+			}
+			std::size_t top = buckets.size() - 1;
+			while (uncovered)
+			{
+				if (buckets[top].empty())
+				{
+					--top;
+					continue;
+				}
+				std::size_t best = buckets[top].back();
+				buckets[top].pop_back();
+				std::uint64_t current = score(best);
+				if (current != top)
+				{
+					buckets[current].push_back(best);
+					continue;
+				}
+				taken[best] = true;
+				order.push_back(instances[best]);
+				forEachFeature(best, [&](CoverageFeature& feature, bool)
+				{
+					if (feature.coveredRound != round)
+					{
+						feature.coveredRound = round;
+						--uncovered;
+					}
+					available -= --feature.remaining == 0 ? 1 : 0;
+				});
+			}
+			for (auto& bucket : buckets)
+			{
+				bucket.clear();
+			}
+		}
+		return order;
+	}
+
+	std::vector<std::string> SweepOrder::changedParameters(const parameterInstanceMap_t& previous, const parameterInstanceMap_t& current)
+	{
+		std::vector<std::string> changed;
+		auto lhs = previous.begin();
+		auto rhs = current.begin();
+		while (lhs != previous.end() || rhs != current.end())
+		{
+			if (rhs == current.end() || (lhs != previous.end() && lhs->first < rhs->first))
+			{
+				changed.push_back(lhs->first);
+				++lhs;
+			}
+			else if (lhs == previous.end() || rhs->first < lhs->first)
+			{
+				changed.push_back(rhs->first);
+				++rhs;
+			}
+			else
+			{
+				if (lhs->second != rhs->second)
+				{
+					changed.push_back(lhs->first);
+				}
+				++lhs;
+				++rhs;
+			}
+		}
+		return changed;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,59 @@
+#pragma once
+#include "Parameters.h"
+#include "CompiledDontCares.h"
+
+namespace parameterCombinator
+{
+	// Cost of changing the value of a parameter and hooks run when it happens
+	struct ParameterSetup
+	{
+		using hook_t = std::function<void(const std::string& name, const Parameter& value)>;
+
+		// Cost of one switch to another value, in any unit shared by all parameters
+		double switchCost = 0.0;
+		// Called before the first combination holding a value
+		hook_t setup;
+		// Called once no more combinations hold the value that was set up
+		hook_t teardown;
+	};
+	using parameterSetups_t = std::map<std::string, ParameterSetup>;
+
+	// Enumeration orders of the combinations of a specification other than the order of the result set
+	class SweepOrder
+	{
+	public:
+		// Called with every distinct combination and the parameters whose value changed, appeared or disappeared
+		// since the previous one. All parameters of the first combination are reported as changed.
+		using stepCallback_t = std::function<void(const parameterInstanceMap_t& paramInstance, const std::vector<std::string>& changed)>;
+
+		// Visits the same combinations combine() produces, in mixed-radix reflected Gray code order: consecutive
+		// elements of the product differ in exactly one parameter. The last parameter in name order changes fastest.
+		// Combinations collapsed by 'dontCares' are visited once, the first time they are reached.
+		// Returns the number of combinations visited.
+		static std::size_t grayCode(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+			const stepCallback_t& callback);
+
+		// Loop nesting, outermost first, minimizing the total switching cost. A parameter with n values nested inside
+		// loops of P iterations switches P * n times, so swapping two adjacent parameters shows the cheapest nesting
+		// sorts them by switchCost * n / (n - 1), highest first. Parameters without a setup cost nothing.
+		static std::vector<std::string> nestingOrder(const parameterCombinations_t& paramCombs, const parameterSetups_t& setups);
+		// Total switching cost of iterating the product of 'paramCombs' with the given nesting, ignoring don't cares
+		static double nestingCost(const parameterCombinations_t& paramCombs, const parameterSetups_t& setups,
+			const std::vector<std::string>& order);
+		// Visits the same combinations combine() produces, nested as nestingOrder() says. Before a combination the
+		// teardown hooks of the values it no longer holds run (innermost first), then the setup hooks of its new
+		// values (outermost first). Every setup hook fires once per distinct prefix of values. The last teardowns run
+		// after the last combination. Returns the number of combinations visited.
+		static std::size_t nested(const parameterCombinations_t& paramCombs, const dontCares_t& dontCares,
+			const parameterSetups_t& setups, const std::function<void(const parameterInstanceMap_t&)>& callback);
+
+		// Anytime order of a result set: every prefix covers as many distinct (parameter, value)s as possible, and
+		// after those as many distinct value pairs, chosen greedily. Once a prefix covers every value and pair the
+		// remaining combinations hold, coverage is counted afresh. A sweep stopped early has then touched every value
+		// it could instead of only the first values of the leading parameters. The pointers refer into 'paramSet'.
+		static std::vector<const parameterInstanceMap_t*> coverageOrder(const parameterInstanceSet_t& paramSet);
+		// Parameters that differ between 'previous' and 'current'
+		static std::vector<std::string> changedParameters(const parameterInstanceMap_t& previous, const parameterInstanceMap_t& current);
+	};
+
+} // Namespace parameterCombinator
@@ -0,0 +1,249 @@
+#include "TimingReport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// Time stamp counter of the core. Counts at a constant rate on current CPUs and needs no performance
+		// counter access.
+		std::uint64_t readCycles()
+		{
+#if defined(__x86_64__) || defined(__i386__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+			return __rdtsc();
+#else
+			return 0;
+#endif
+		}
+
+		// Nearest rank percentile. Reorders 'values'.
+		double percentile(std::vector<double>& values, double fraction)
+		{
+			std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(values.size())));
+			auto nth = values.begin() + static_cast<std::ptrdiff_t>(std::max<std::size_t>(rank, 1) - 1);
+			std::nth_element(values.begin(), nth, values.end());
+			return *nth;
+		}
+
+		std::string jsonString(const std::string& text)
+		{
+			std::string quoted = "\"";
+			for (char c : text)
+			{
+				switch (c)
+				{
+				case '"':
+					quoted += "\\\"";
+					break;
+				case '\\':
+					quoted += "\\\\";
+					break;
+				case '\n':
+					quoted += "\\n";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char escaped[8];
+						std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+						quoted += escaped;
+					}
+					else
+					{
+						quoted += c;
+					}
+				}
+			}
+			return quoted + "\"";
+		}
+	}
+
+	std::string TimingReport::toJson() const
+	{
+		std::ostringstream out;
+		out.precision(9);
+		out << "{\"samples\":" << samples
+			<< ",\"totalSeconds\":" << totalSeconds
+			<< ",\"grandMean\":" << grandMean
+			<< ",\"parameters\":[";
+		for (std::size_t i = 0; i < parameters.size(); ++i)
+		{
+			out << (i ? "," : "") << "{\"parameter\":" << jsonString(parameters[i].parameter)
+				<< ",\"effectRange\":" << parameters[i].effectRange << "}";
+		}
+		out << "],\"values\":[";
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			const ValueTiming& value = values[i];
+			out << (i ? "," : "") << "{\"parameter\":" << jsonString(value.parameter)
+				<< ",\"value\":" << jsonString(value.value)
+				<< ",\"samples\":" << value.samples
+				<< ",\"mean\":" << value.mean
+				<< ",\"p50\":" << value.p50
+				<< ",\"p99\":" << value.p99
+				<< ",\"meanCycles\":" << value.meanCycles
+				<< ",\"mainEffect\":" << value.mainEffect << "}";
+		}
+		out << "],\"interactions\":[";
+		for (std::size_t i = 0; i < interactions.size(); ++i)
+		{
+			const InteractionTiming& interaction = interactions[i];
+			out << (i ? "," : "") << "{\"parameter1\":" << jsonString(interaction.parameter1)
+				<< ",\"value1\":" << jsonString(interaction.value1)
+				<< ",\"parameter2\":" << jsonString(interaction.parameter2)
+				<< ",\"value2\":" << jsonString(interaction.value2)
+				<< ",\"samples\":" << interaction.samples
+				<< ",\"mean\":" << interaction.mean
+				<< ",\"interaction\":" << interaction.interaction << "}";
+		}
+		out << "]}";
+		return out.str();
+	}
+
+	TimingExecutor::TimingExecutor(const TimingOptions& options)
+		: options_(options)
+	{
+		if (options_.repetitions == 0)
+		{
+			throw std::invalid_argument("TimingOptions::repetitions must be at least 1.");
+		}
+	}
+
+	TimingReport TimingExecutor::run(const parameterInstanceSet_t& paramSet, const callback_t& callback) const
+	{
+		std::vector<Sample> samples;
+		samples.reserve(paramSet.size());
+		double repetitions = static_cast<double>(options_.repetitions);
+		for (auto& paramInstance : paramSet)
+		{
+			auto start = std::chrono::steady_clock::now();
+			std::uint64_t startCycles = readCycles();
+			for (std::size_t repetition = 0; repetition < options_.repetitions; ++repetition)
+			{
+				callback(paramInstance);
+			}
+			std::uint64_t cycles = readCycles() - startCycles;
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			samples.push_back({ &paramInstance, seconds / repetitions, static_cast<double>(cycles) / repetitions });
+		}
+		return analyze(samples);
+	}
+
+	TimingReport TimingExecutor::analyze(const std::vector<Sample>& samples) const
+	{
+		TimingReport report;
+		report.samples = samples.size();
+		if (samples.empty())
+		{
+			return report;
+		}
+
+		struct Group
+		{
+			std::vector<double> seconds;
+			double cycles = 0.0;
+		};
+		struct Pair
+		{
+			double seconds = 0.0;
+			std::size_t samples = 0;
+		};
+		// Group of every (parameter, value), and the sums of every pair of groups seen in one combination. Pairs are
+		// keyed in parameter name order.
+		std::map<std::string, std::map<Parameter, std::size_t>> groupIds;
+		std::vector<Group> groups;
+		std::map<std::pair<std::size_t, std::size_t>, Pair> pairs;
+		std::vector<std::size_t> ids;
+		for (auto& sample : samples)
+		{
+			report.totalSeconds += sample.seconds;
+			ids.clear();
+			for (auto& [name, value] : *sample.paramInstance)
+			{
+				auto [id, isNew] = groupIds[name].try_emplace(value, groups.size());
+				if (isNew)
+				{
+					groups.emplace_back();
+				}
+				groups[id->second].seconds.push_back(sample.seconds);
+				groups[id->second].cycles += sample.cycles;
+				ids.push_back(id->second);
+			}
+			for (std::size_t first = 0; first < ids.size(); ++first)
+			{
+				for (std::size_t second = first + 1; second < ids.size(); ++second)
+				{
+					Pair& pair = pairs[{ ids[first], ids[second] }];
+					pair.seconds += sample.seconds;
+					++pair.samples;
+				}
+			}
+		}
+		report.grandMean = report.totalSeconds / static_cast<double>(samples.size());
+
+		// Position of every group in report.values
+		std::vector<std::size_t> valueById(groups.size());
+		report.values.reserve(groups.size());
+		for (auto& [name, values] : groupIds)
+		{
+			double lowest = 0.0;
+			double highest = 0.0;
+			for (auto& [value, id] : values)
+			{
+				Group& group = groups[id];
+				ValueTiming timing;
+				timing.parameter = name;
+				timing.value = value->toString();
+				timing.samples = group.seconds.size();
+				double sum = 0.0;
+				for (double seconds : group.seconds)
+				{
+					sum += seconds;
+				}
+				timing.mean = sum / static_cast<double>(timing.samples);
+				timing.meanCycles = group.cycles / static_cast<double>(timing.samples);
+				timing.p50 = percentile(group.seconds, 0.5);
+				timing.p99 = percentile(group.seconds, 0.99);
+				timing.mainEffect = timing.mean - report.grandMean;
+				lowest = id == values.begin()->second ? timing.mainEffect : std::min(lowest, timing.mainEffect);
+				highest = id == values.begin()->second ? timing.mainEffect : std::max(highest, timing.mainEffect);
+				valueById[id] = report.values.size();
+				report.values.push_back(std::move(timing));
+			}
+			report.parameters.push_back({ name, highest - lowest });
+		}
+		std::stable_sort(report.parameters.begin(), report.parameters.end(), [](const ParameterTiming& lhs, const ParameterTiming& rhs)
+		{
+			return lhs.effectRange > rhs.effectRange;
+		});
+
+		report.interactions.reserve(pairs.size());
+		for (auto& [ids, pair] : pairs)
+		{
+			const ValueTiming& first = report.values[valueById[ids.first]];
+			const ValueTiming& second = report.values[valueById[ids.second]];
+			double mean = pair.seconds / static_cast<double>(pair.samples);
+			report.interactions.push_back({ first.parameter, first.value, second.parameter, second.value, pair.samples,
+				mean, mean - first.mean - second.mean + report.grandMean });
+		}
+		std::stable_sort(report.interactions.begin(), report.interactions.end(), [](const InteractionTiming& lhs, const InteractionTiming& rhs)
+		{
+			return std::abs(lhs.interaction) > std::abs(rhs.interaction);
+		});
+		if (options_.topInteractions && report.interactions.size() > options_.topInteractions)
+		{
+			report.interactions.resize(options_.topInteractions);
+		}
+		return report;
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,87 @@
+#pragma once
+#include "ParameterCombinator.h"
+
+namespace parameterCombinator
+{
+	struct TimingOptions
+	{
+		// Evaluations per combination. The mean of the repetitions is its sample.
+		std::size_t repetitions = 1;
+		// Pairwise interactions kept in the report, largest first. 0 keeps all of them.
+		std::size_t topInteractions = 20;
+	};
+
+	// Timing of the combinations holding one parameter value. Times are in seconds.
+	struct ValueTiming
+	{
+		std::string parameter;
+		std::string value;
+		std::size_t samples = 0;
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p99 = 0.0;
+		// Mean time stamp counter cycles, 0 where the platform has no such counter
+		double meanCycles = 0.0;
+		// mean - grand mean
+		double mainEffect = 0.0;
+	};
+
+	// Mean of the combinations holding two parameter values and what it adds beyond both main effects:
+	// mean - mean(value1) - mean(value2) + grand mean
+	struct InteractionTiming
+	{
+		std::string parameter1;
+		std::string value1;
+		std::string parameter2;
+		std::string value2;
+		std::size_t samples = 0;
+		double mean = 0.0;
+		double interaction = 0.0;
+	};
+
+	struct ParameterTiming
+	{
+		std::string parameter;
+		// Largest minus smallest main effect of its values. Slow dimensions have large ranges.
+		double effectRange = 0.0;
+	};
+
+	struct TimingReport
+	{
+		std::size_t samples = 0;
+		double totalSeconds = 0.0;
+		double grandMean = 0.0;
+		// Sorted by effect range, largest first
+		std::vector<ParameterTiming> parameters;
+		// Sorted by parameter and value
+		std::vector<ValueTiming> values;
+		// Sorted by absolute interaction, largest first
+		std::vector<InteractionTiming> interactions;
+
+		std::string toJson() const;
+	};
+
+	// Evaluates a result set on the calling thread, timing every evaluation, and attributes the time to the parameter
+	// values of the combinations.
+	class TimingExecutor
+	{
+	public:
+		using callback_t = std::function<void(const parameterInstanceMap_t&)>;
+		struct Sample
+		{
+			const parameterInstanceMap_t* paramInstance;
+			double seconds;
+			double cycles;
+		};
+
+		explicit TimingExecutor(const TimingOptions& options = TimingOptions{});
+
+		TimingReport run(const parameterInstanceSet_t& paramSet, const callback_t& callback) const;
+		// Builds the report from timings measured elsewhere
+		TimingReport analyze(const std::vector<Sample>& samples) const;
+
+	private:
+		TimingOptions options_;
+	};
+
+} // Namespace parameterCombinator
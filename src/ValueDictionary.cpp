@@ -0,0 +1,76 @@
+#include "ValueDictionary.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+namespace parameterCombinator
+{
+	namespace
+	{
+		// Dictionaries are told apart by id rather than address, so a dictionary allocated where a destroyed one
+		// lived never compares its values by the ranks of the old one
+		std::atomic<std::uint64_t> nextDictionary{ 1 };
+	}
+
+	ValueDictionary::ValueDictionary(const ParametersVec& values)
+	{
+		if (values.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::invalid_argument("Too many values for a value dictionary.");
+		}
+		std::vector<Parameter> inputs(values.begin(), values.end());
+		std::vector<std::uint32_t> order(inputs.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs)
+		{
+			return inputs[lhs] < inputs[rhs];
+		});
+
+		std::uint64_t dictionary = nextDictionary.fetch_add(1, std::memory_order_relaxed);
+		ids_.resize(inputs.size());
+		for (auto index : order)
+		{
+			if (values_.empty() || values_.back() < inputs[index])
+			{
+				auto interned = inputs[index]->clone();
+				interned->dictionary_ = dictionary;
+				interned->rank_ = static_cast<std::uint32_t>(values_.size());
+				Parameter value;
+				value.param_ = std::move(interned);
+				values_.push_back(std::move(value));
+			}
+			ids_[index] = static_cast<std::uint32_t>(values_.size() - 1);
+		}
+	}
+
+	std::size_t ValueDictionary::size() const
+	{
+		return values_.size();
+	}
+
+	std::uint32_t ValueDictionary::id(std::size_t index) const
+	{
+		return ids_.at(index);
+	}
+
+	const Parameter& ValueDictionary::value(std::uint32_t id) const
+	{
+		return values_.at(id);
+	}
+
+	std::optional<std::uint32_t> ValueDictionary::find(const Parameter& value) const
+	{
+		auto found = std::lower_bound(values_.begin(), values_.end(), value);
+		if (found == values_.end() || *found != value)
+		{
+			return std::nullopt;
+		}
+		return static_cast<std::uint32_t>(found - values_.begin());
+	}
+
+	const Parameter& ValueDictionary::operator[](std::size_t index) const
+	{
+		return values_[ids_[index]];
+	}
+
+} // Namespace parameterCombinator
@@ -0,0 +1,31 @@
+#pragma once
+#include "Parameters.h"
+
+namespace parameterCombinator
+{
+	// Distinct values of one parameter, sorted, with one shared copy each. The copies compare with each other by
+	// rank: an integer compare without virtual calls, typeid checks or copies. Against any other value they compare
+	// as usual. combine() interns the values of every parameter, so the result set orders its combinations this way.
+	class ValueDictionary
+	{
+	public:
+		explicit ValueDictionary(const ParametersVec& values);
+
+		// Number of distinct values
+		std::size_t size() const;
+		// Rank of values[index] of the ParametersVec the dictionary was built from. Equal values share it and ranks
+		// order like the values.
+		std::uint32_t id(std::size_t index) const;
+		// Interned copy of the distinct value of rank 'id'
+		const Parameter& value(std::uint32_t id) const;
+		// Rank of 'value', if the dictionary holds it
+		std::optional<std::uint32_t> find(const Parameter& value) const;
+		// Interned copy of values[index]
+		const Parameter& operator[](std::size_t index) const;
+
+	private:
+		std::vector<Parameter> values_;
+		std::vector<std::uint32_t> ids_;
+	};
+
+} // Namespace parameterCombinator
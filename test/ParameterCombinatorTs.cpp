@@ -1,6 +1,21 @@
 #include "ParameterCombinator.h"
+#include "SuccessiveHalving.h"
+#include "SweepJournal.h"
+#include "SweepOrder.h"
+#include "ProcessPool.h"
+#include "ExternalCombinator.h"
+#include "FanOut.h"
+#include "TimingReport.h"
+#include "ResultsStore.h"
+#include "CompressedCombinations.h"
 #include <iostream>
 #include <cassert>
+#include <mutex>
+#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <csignal>
+#include <random>
 
 using namespace parameterCombinator;
 
@@ -19,6 +34,22 @@ bool operator==(const point_t& lhs, const point_t& rhs)
 	return result;
 }
 
+// Can be copied but not assigned
+struct label_t
+{
+	const int id;
+};
+
+bool operator<(const label_t& lhs, const label_t& rhs)
+{
+	return lhs.id < rhs.id;
+}
+
+bool operator==(const label_t& lhs, const label_t& rhs)
+{
+	return lhs.id == rhs.id;
+}
+
 void printDifferences(const parameterInstanceSet_t& expectedCombinations, const parameterInstanceSet_t* paramSet)
 {
 	std::cout << "Size of output: " << paramSet->size() << std::endl;
@@ -71,7 +102,7 @@ void printDifferences(const parameterInstanceSet_t& expectedCombinations, const
 bool checkEquality(const parameterInstanceSet_t& expectedCombinations, ParameterCombinator& paramCombinator)
 {
 	bool failed = false;
-	const parameterInstanceSet_t* paramSet = paramCombinator.getParameterInstanceSet();
+	auto paramSet = paramCombinator.getParameterInstanceSet();
 
 	failed |= !(expectedCombinations.size() == paramSet->size());
 
@@ -85,11 +116,21 @@ bool checkEquality(const parameterInstanceSet_t& expectedCombinations, Parameter
 	}
 	if (failed)
 	{
-		printDifferences(expectedCombinations, paramSet);
+		printDifferences(expectedCombinations, paramSet.get());
 	}
 	return failed;
 }
 
+std::set<std::string> combinationNames(const parameterInstanceSet_t& paramSet)
+{
+	std::set<std::string> names;
+	for (auto& paramInstance : paramSet)
+	{
+		names.insert(ParameterCombinator::generateCombinationName(paramInstance));
+	}
+	return names;
+}
+
 bool testSimpleCombination()
 {
 	// List of parameters to test
@@ -358,6 +399,14 @@ void testParameter()
 		assert(a <= b);
 		assert(b >= a);
 	}
+	// String literals order like their text, not like their first character
+	{
+		Parameter a = "mb";
+		Parameter b = "mx";
+		assert(a < b);
+		assert(!(b < a));
+		assert(a != b);
+	}
 	// Test parameters of different type
 	{
 		Parameter a = 'a';
@@ -585,8 +634,8 @@ bool testAddition()
 		{{"vehicle", "motorbike"}},
 	};
 
-	//paramCombinator3.addCombinations(paramCombinator1, paramCombinator2, dontCares2);
-	//failed |= checkEquality(expectedCombinations4, paramCombinator3);
+	paramCombinator3.addCombinations(paramCombinator1, paramCombinator2, dontCares2);
+	failed |= checkEquality(expectedCombinations4, paramCombinator3);
 
 	return failed;
 
@@ -608,6 +657,1432 @@ bool testGenerateCombinationName()
 	return failed;
 }
 
+bool testLazyParametersVec()
+{
+	bool failed = false;
+
+	ParametersVec range = ParametersVec::range(1, 100001);
+	failed |= !(range.isLazy() && range.size() == 100000);
+	failed |= !(getVal<int>(range[0]) == 1 && getVal<int>(range[99999]) == 100000);
+	failed |= !(ParametersVec::range(10, 0, -3).size() == 4);
+	failed |= !(ParametersVec::range(0.0, 1.0, 0.25).size() == 4);
+	// Indices beyond the range of a narrow type still give values of that type
+	ParametersVec narrow = ParametersVec::range<std::int8_t>(-100, 100);
+	failed |= !(narrow.size() == 200 && getVal<std::int8_t>(narrow[0]) == -100 && getVal<std::int8_t>(narrow[199]) == 99);
+	failed |= !(getVal<std::int8_t>(ParametersVec::range<std::int8_t>(120, -120, -2)[119]) == -118);
+	ParametersVec wide = ParametersVec::range(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+	failed |= !(getVal<int>(wide[wide.size() - 1]) == std::numeric_limits<int>::max() - 1);
+
+	ParametersVec linspace = ParametersVec::linspace(0.0, 1.0, 5);
+	failed |= !(getVal<double>(linspace[0]) == 0.0 && getVal<double>(linspace[2]) == 0.5 && getVal<double>(linspace[4]) == 1.0);
+
+	ParametersVec logspace = ParametersVec::logspace(0.0, 2.0, 3);
+	failed |= !(getVal<double>(logspace[1]) == 10.0 && getVal<double>(logspace[2]) == 100.0);
+
+	ParametersVec generated(3, [](std::size_t idx) { return Parameter(std::string(idx + 1, 'x')); });
+	failed |= !(getVal<std::string>(generated[2]) == "xxx");
+
+	// Appending to a lazy list keeps the generated values
+	generated.push_back(std::string{ "y" });
+	failed |= !(!generated.isLazy() && generated.size() == 4 && getVal<std::string>(generated[0]) == "x");
+
+	// Generated values take part in combination and don't cares like any other value
+	parameterCombinations_t paramCombs;
+	paramCombs["vehicle"]    = { "car", "motorbike" };
+	paramCombs["horsepower"] = ParametersVec::range(100, 140, 10);
+	paramCombs["AC"]         = { 0, 1 };
+
+	dontCares_t dontCares =
+	{
+		{"horsepower",
+			{
+				{130, {"AC"}}
+			}
+		}
+	};
+
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+
+	const parameterInstanceSet_t expectedCombinations
+	{
+		{{"vehicle", "car"},       {"horsepower", 100}, {"AC", 0}},
+		{{"vehicle", "car"},       {"horsepower", 100}, {"AC", 1}},
+		{{"vehicle", "car"},       {"horsepower", 110}, {"AC", 0}},
+		{{"vehicle", "car"},       {"horsepower", 110}, {"AC", 1}},
+		{{"vehicle", "car"},       {"horsepower", 120}, {"AC", 0}},
+		{{"vehicle", "car"},       {"horsepower", 120}, {"AC", 1}},
+		{{"vehicle", "car"},       {"horsepower", 130}},
+		{{"vehicle", "motorbike"}, {"horsepower", 100}, {"AC", 0}},
+		{{"vehicle", "motorbike"}, {"horsepower", 100}, {"AC", 1}},
+		{{"vehicle", "motorbike"}, {"horsepower", 110}, {"AC", 0}},
+		{{"vehicle", "motorbike"}, {"horsepower", 110}, {"AC", 1}},
+		{{"vehicle", "motorbike"}, {"horsepower", 120}, {"AC", 0}},
+		{{"vehicle", "motorbike"}, {"horsepower", 120}, {"AC", 1}},
+		{{"vehicle", "motorbike"}, {"horsepower", 130}},
+	};
+
+	failed |= checkEquality(expectedCombinations, paramCombinator);
+
+	return failed;
+}
+
+bool testNestedParameterSpace()
+{
+	bool failed = false;
+
+	// Motorbike only parameters live under the motorbike branch, car only parameters under the car branch
+	ParameterSpace paramSpace;
+	paramSpace.parameters["vehicle"]    = { "car", "motorbike" };
+	paramSpace.parameters["horsepower"] = { 100, 130 };
+	paramSpace.parameters["motor"]      = { "gasoline", "electric" };
+
+	ParameterSpace carSpace;
+	carSpace.parameters["AC"] = { 0, 1 };
+	ParameterSpace motorbikeSpace;
+	motorbikeSpace.parameters["wind-protector"] = { 0, 1 };
+	ParameterSpace combustionSpace;
+	combustionSpace.parameters["fuel-consumption"] = { 2.3, 4.1 };
+
+	paramSpace.branches["vehicle"] = { { "car", carSpace }, { "motorbike", motorbikeSpace } };
+	paramSpace.branches["motor"]   = { { "gasoline", combustionSpace } };
+
+	dontCares_t dontCares{};
+	ParameterCombinator treeCombinator;
+	treeCombinator.combine(paramSpace, dontCares);
+
+	// Same space expressed through global parameters and don't cares
+	parameterCombinations_t paramCombs;
+	paramCombs["vehicle"]          = { "car", "motorbike" };
+	paramCombs["horsepower"]       = { 100, 130 };
+	paramCombs["motor"]            = { "gasoline", "electric" };
+	paramCombs["AC"]               = { 0, 1 };
+	paramCombs["wind-protector"]   = { 0, 1 };
+	paramCombs["fuel-consumption"] = { 2.3, 4.1 };
+
+	dontCares_t flatDontCares =
+	{
+		{"vehicle",
+			{
+				{"car",
+					{"wind-protector"}
+				},
+				{"motorbike",
+					{"AC"}
+				}
+			}
+		},
+		{"motor",
+			{
+				{"electric",
+					{"fuel-consumption"}
+				}
+			}
+		}
+	};
+
+	ParameterCombinator flatCombinator;
+	flatCombinator.combine(paramCombs, flatDontCares);
+
+	failed |= !(treeCombinator.getParameterInstanceSet()->size() == 24);
+	failed |= !(combinationNames(*treeCombinator.getParameterInstanceSet()) == combinationNames(*flatCombinator.getParameterInstanceSet()));
+
+	// Sub-spaces cannot redefine a parameter of an enclosing space
+	ParameterSpace badSpace;
+	badSpace.parameters["vehicle"] = { "car" };
+	ParameterSpace badCarSpace;
+	badCarSpace.parameters["vehicle"] = { "truck" };
+	badSpace.branches["vehicle"] = { { "car", badCarSpace } };
+	try
+	{
+		treeCombinator.combine(badSpace, dontCares);
+		failed = true;
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+
+	return failed;
+}
+
+bool testCombineStats()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["vehicle"]      = { "car", "motorbike" };
+	paramCombs["horsepower"]   = { 100, 130 };
+	paramCombs["AC"]           = { 0, 1 };
+	paramCombs["nobody-cares"] = { "1", "2", "3" };
+
+	dontCares_t dontCares =
+	{
+		{"vehicle",
+			{
+				{"motorbike",
+					{"AC"}
+				}
+			}
+		},
+		{"nobody-cares",{}}
+	};
+
+	CombineStats stats;
+	CombineOptions options;
+	options.stats = &stats;
+	std::size_t probeCalls = 0;
+	options.bytesInUse = [&probeCalls]() { return ++probeCalls * 10; };
+
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares, options);
+
+	failed |= !(stats.rawCombinations == 24);
+	failed |= !(stats.distinctCombinations == 6);
+	failed |= !(stats.duplicatesCollapsed == 18);
+	// Every duplicate had "nobody-cares" removed, only motorbike duplicates had AC removed
+	failed |= !(stats.duplicatesPerRule["nobody-cares"] == 18);
+	failed |= !(stats.duplicatesPerRule["vehicle=motorbike"] == 10);
+	failed |= !(stats.comparatorCalls > 0);
+	failed |= !(paramCombinator.getParameterInstanceSet()->key_comp().callCounter_ == nullptr);
+	failed |= !(stats.peakBytes == 240);
+
+	std::map<std::string, double> counters;
+	stats.exportCounters([&counters](const std::string& name, double value) { counters[name] = value; });
+	failed |= !(counters["rawCombinations"] == 24.0 && counters["duplicatesPerRule.vehicle=motorbike"] == 10.0);
+	failed |= !(counters.count("insertionTimeNs") && counters.count("productTimeNs"));
+
+	// Statistics are reset on every call and are optional
+	paramCombinator.combine(paramCombs, dontCares, options);
+	failed |= !(stats.rawCombinations == 24);
+	paramCombinator.combine(paramCombs, dontCares);
+	failed |= !(paramCombinator.getParameterInstanceSet()->size() == 6);
+
+	return failed;
+}
+
+bool testArenaStorage()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["vehicle"]          = { "car", "motorbike" };
+	paramCombs["horsepower"]       = ParametersVec::range(100, 200, 10);
+	paramCombs["fuel-consumption"] = { 2.3, 4.1 };
+
+	dontCares_t dontCares =
+	{
+		{"vehicle",
+			{
+				{"motorbike",
+					{"fuel-consumption"}
+				}
+			}
+		}
+	};
+
+	ParameterCombinator heapCombinator;
+	heapCombinator.combine(paramCombs, dontCares);
+
+	ParameterCombinator arenaCombinator(StorageMode::Arena);
+	failed |= !(arenaCombinator.storageMode() == StorageMode::Arena);
+	CombineStats stats;
+	CombineOptions options;
+	options.stats = &stats;
+	arenaCombinator.combine(paramCombs, dontCares, options);
+
+	const std::set<std::string> expectedNames = combinationNames(*heapCombinator.getParameterInstanceSet());
+	failed |= !(expectedNames.size() == 30);
+	failed |= !(combinationNames(*arenaCombinator.getParameterInstanceSet()) == expectedNames);
+	// Peak bytes come from the arena when no probe is given
+	failed |= !(stats.peakBytes > 0);
+
+	// Copies share the arena backed result
+	ParameterCombinator copy = arenaCombinator;
+	failed |= !(copy.storageMode() == StorageMode::Arena && copy.getParameterInstanceSet()->size() == 30);
+
+	// Recombining and clearing publish new results. The copy keeps the previous one.
+	arenaCombinator.combine(paramCombs, dontCares);
+	failed |= !(combinationNames(*arenaCombinator.getParameterInstanceSet()) == expectedNames);
+	arenaCombinator.clearCombinations();
+	failed |= !(arenaCombinator.getParameterInstanceSet()->empty());
+	failed |= !(copy.getParameterInstanceSet()->size() == 30);
+
+	// Adding combinations into an arena
+	ParameterCombinator sum(StorageMode::Arena);
+	sum.addCombinations(heapCombinator, heapCombinator, dontCares);
+	failed |= !(combinationNames(*sum.getParameterInstanceSet()) == expectedNames);
+
+	return failed;
+}
+
+bool testBatchIteration()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["motor"]            = { "gasoline", "electric" };
+	paramCombs["horsepower"]       = ParametersVec::range(100, 200, 10);
+	paramCombs["fuel-consumption"] = { 2.3, 4.1 };
+	paramCombs["airbag"]           = { false, true };
+
+	dontCares_t dontCares =
+	{
+		{"motor",
+			{
+				{"electric",
+					{"fuel-consumption"}
+				}
+			}
+		}
+	};
+
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+
+	// Reference values through the map interface
+	long long expectedHorsepower = 0;
+	double expectedFuel = 0.0;
+	std::size_t expectedAirbags = 0;
+	for (auto& paramInstance : *paramCombinator.getParameterInstanceSet())
+	{
+		expectedHorsepower += getVal<int>(paramInstance, "horsepower");
+		expectedAirbags += getVal<bool>(paramInstance, "airbag");
+		if (paramInstance.count("fuel-consumption"))
+		{
+			expectedFuel += getVal<double>(paramInstance, "fuel-consumption");
+		}
+	}
+
+	std::size_t rows = 0;
+	std::size_t batches = 0;
+	long long horsepower = 0;
+	double fuel = 0.0;
+	std::size_t airbags = 0;
+	paramCombinator.forEachBatch(16, [&](const ParameterBatch& batch)
+	{
+		++batches;
+		failed |= !(batch.size() <= 16 && batch.hasColumn("horsepower") && !batch.hasColumn("nobody-cares"));
+		const int* hp = batch.column<int>("horsepower");
+		const bool* airbag = batch.column<bool>("airbag");
+		const double* fc = batch.column<double>("fuel-consumption");
+		const std::uint64_t* fcPresence = batch.presence("fuel-consumption");
+		for (std::size_t row = 0; row < batch.size(); ++row)
+		{
+			horsepower += hp[row];
+			airbags += airbag[row];
+			bool present = (fcPresence[row / 64] >> (row % 64)) & 1;
+			failed |= !(present == static_cast<bool>(batch.instance(row).count("fuel-consumption")));
+			if (present)
+			{
+				fuel += fc[row];
+			}
+		}
+		rows += batch.size();
+
+		// Columns are typed
+		try
+		{
+			batch.column<double>("horsepower");
+			failed = true;
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+	});
+
+	failed |= !(rows == paramCombinator.getParameterInstanceSet()->size());
+	failed |= !(batches == (rows + 15) / 16);
+	failed |= !(horsepower == expectedHorsepower && airbags == expectedAirbags);
+	failed |= !(std::abs(fuel - expectedFuel) < 1e-9);
+
+	// Columns of values that can not be assigned
+	parameterCombinations_t labelCombs;
+	labelCombs["label"] = { label_t{ 1 }, label_t{ 2 }, label_t{ 3 } };
+	labelCombs["other"] = { 0, 1 };
+	dontCares_t labelDontCares = { { "other", { { 1, { "label" } } } } };
+	ParameterCombinator labelCombinator;
+	labelCombinator.combine(labelCombs, labelDontCares);
+	int labelSum = 0;
+	labelCombinator.forEachBatch(64, [&](const ParameterBatch& batch)
+	{
+		const label_t* label = batch.column<label_t>("label");
+		for (std::size_t row = 0; row < batch.size(); ++row)
+		{
+			labelSum += batch.isPresent("label", row) ? label[row].id : 0;
+		}
+	});
+	failed |= !(labelSum == 6);
+
+	return failed;
+}
+
+bool testPipeline()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["vehicle"]      = { "car", "motorbike" };
+	paramCombs["horsepower"]   = ParametersVec::range(100, 300, 5);
+	paramCombs["AC"]           = { 0, 1 };
+	paramCombs["nobody-cares"] = { "1", "2" };
+
+	dontCares_t dontCares =
+	{
+		{"vehicle",
+			{
+				{"motorbike",
+					{"AC"}
+				}
+			}
+		},
+		{"nobody-cares",{}}
+	};
+
+	std::mutex namesMutex;
+	std::set<std::string> evaluatedNames;
+	PipelineOptions options;
+	options.workers = 4;
+	// Small queue so that generation has to wait for the evaluators
+	options.queueCapacity = 4;
+
+	ParameterCombinator paramCombinator;
+	std::size_t evaluated = paramCombinator.combineAndEvaluate(paramCombs, dontCares,
+		[&](const parameterInstanceMap_t& paramInstance)
+		{
+			std::string name = ParameterCombinator::generateCombinationName(paramInstance);
+			std::lock_guard<std::mutex> lock(namesMutex);
+			evaluatedNames.insert(name);
+		}, options);
+
+	// Every distinct combination is evaluated exactly once and the result set is kept
+	failed |= !(evaluated == paramCombinator.getParameterInstanceSet()->size());
+	failed |= !(evaluatedNames == combinationNames(*paramCombinator.getParameterInstanceSet()));
+
+	ParameterCombinator reference;
+	reference.combine(paramCombs, dontCares);
+	failed |= !(evaluatedNames == combinationNames(*reference.getParameterInstanceSet()));
+
+	// Evaluator errors stop the pipeline and are reported to the caller
+	try
+	{
+		paramCombinator.combineAndEvaluate(paramCombs, dontCares, [](const parameterInstanceMap_t& paramInstance)
+			{
+				if (getVal<int>(paramInstance, "horsepower") == 200)
+				{
+					throw std::runtime_error("Evaluation failed");
+				}
+			}, options);
+		failed = true;
+	}
+	catch (const std::runtime_error&)
+	{
+	}
+
+	// Generation stops at the next combination even when the queue has room, and nothing is published
+	std::atomic<bool> thrown{ false };
+	std::atomic<std::size_t> generated{ 0 };
+	parameterCombinations_t longCombs;
+	longCombs["x"] = ParametersVec(100000, [&](std::size_t idx)
+		{
+			if (idx == 10)
+			{
+				while (!thrown)
+				{
+					std::this_thread::yield();
+				}
+			}
+			generated = idx + 1;
+			return Parameter(static_cast<int>(idx));
+		});
+	PipelineOptions largeQueue;
+	largeQueue.workers = 1;
+	largeQueue.queueCapacity = 1000000;
+	dontCares_t noDontCares;
+	ParameterCombinator abortedCombinator;
+	try
+	{
+		abortedCombinator.combineAndEvaluate(longCombs, noDontCares, [&](const parameterInstanceMap_t&)
+			{
+				thrown = true;
+				throw std::runtime_error("Evaluation failed");
+			}, largeQueue);
+		failed = true;
+	}
+	catch (const std::runtime_error&)
+	{
+	}
+	failed |= !(generated < 100000 && abortedCombinator.getParameterInstanceSet()->empty());
+
+	return failed;
+}
+
+bool testCompiledDontCares()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["motor"]            = { "gasoline", "electric" };
+	paramCombs["horsepower"]       = ParametersVec::range(100, 200, 10);
+	paramCombs["fuel-consumption"] = { 2.3, 4.1 };
+	paramCombs["airbag"]           = { false, true };
+
+	dontCares_t dontCares =
+	{
+		{"motor",
+			{
+				{"electric",
+					{"fuel-consumption"}
+				}
+			}
+		}
+	};
+
+	// 10 horsepowers * 2 airbags * (2 gasoline fuel consumptions + 1 electric)
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+	failed |= !(paramSet->size() == 60);
+	for (auto& paramInstance : *paramSet)
+	{
+		failed |= !(paramSet->count(paramInstance) == 1);
+	}
+	// Lookups remove the don't care parameters of the probe once, so instances still holding them are found too.
+	// The result set itself compares its stripped instances without the rules.
+	parameterInstanceMap_t electric{ {"motor", "electric"}, {"horsepower", 150}, {"fuel-consumption", 4.1}, {"airbag", true} };
+	failed |= !(paramCombinator.contains(electric) && paramSet->count(electric) == 0);
+	failed |= !(paramSet->key_comp().rules_ == nullptr);
+
+	// Every insertion costs a binary search of plain compares, not a rule evaluation per compare
+	CombineOptions options;
+	CombineStats stats;
+	options.stats = &stats;
+	paramCombinator.combine(paramCombs, dontCares, options);
+	std::uint64_t depth = 0;
+	while ((std::uint64_t(1) << depth) < stats.distinctCombinations)
+	{
+		++depth;
+	}
+	failed |= !(stats.rawCombinations == 80 && stats.distinctCombinations == 60);
+	failed |= !(stats.comparatorCalls > 0 && stats.comparatorCalls <= stats.rawCombinations * (2 * depth + 2));
+
+	// Rules apply in key order and only while their parameter is present, so "b" can not disable "c" once "a"
+	// disabled "b"
+	parameterCombinations_t chainCombs;
+	chainCombs["a"] = { 0, 1 };
+	chainCombs["b"] = { 0, 1 };
+	chainCombs["c"] = { 0, 1 };
+	dontCares_t chain =
+	{
+		{"a", { {1, {"b"}} } },
+		{"b", { {1, {"c"}} } },
+	};
+	ParameterCombinator chainCombinator;
+	chainCombinator.combine(chainCombs, chain);
+	const parameterInstanceSet_t expectedChain
+	{
+		{{"a", 0}, {"b", 0}, {"c", 0}},
+		{{"a", 0}, {"b", 0}, {"c", 1}},
+		{{"a", 0}, {"b", 1}},
+		{{"a", 1}, {"c", 0}},
+		{{"a", 1}, {"c", 1}},
+	};
+	failed |= checkEquality(expectedChain, chainCombinator);
+
+	// The tree path compiles the same rules
+	ParameterSpace chainSpace;
+	chainSpace.parameters = chainCombs;
+	ParameterCombinator treeCombinator;
+	treeCombinator.combine(chainSpace, chain);
+	failed |= checkEquality(expectedChain, treeCombinator);
+
+	// The comparator is a strict weak ordering for instances with different parameters
+	std::vector<parameterInstanceMap_t> instances
+	{
+		{{"a", 1}, {"b", 0}, {"c", 0}},
+		{{"a", 1}, {"c", 0}},
+		{{"a", 0}, {"b", 1}, {"c", 1}},
+		{{"a", 0}, {"b", 1}},
+		{{"a", 0}},
+		{{"b", 1}},
+		{{"c", 0}, {"d", 2}},
+	};
+	ParameterInstanceSetCompare cmp(chain);
+	for (auto& x : instances)
+	{
+		failed |= cmp(x, x);
+		for (auto& y : instances)
+		{
+			failed |= cmp(x, y) && cmp(y, x);
+			for (auto& z : instances)
+			{
+				bool equivalentXY = !cmp(x, y) && !cmp(y, x);
+				bool equivalentYZ = !cmp(y, z) && !cmp(z, y);
+				bool equivalentXZ = !cmp(x, z) && !cmp(z, x);
+				failed |= cmp(x, y) && cmp(y, z) && !cmp(x, z);
+				failed |= equivalentXY && equivalentYZ && !equivalentXZ;
+			}
+		}
+	}
+	failed |= !(!cmp(instances[0], instances[1]) && !cmp(instances[1], instances[0]));
+	failed |= !(!cmp(instances[2], instances[3]) && !cmp(instances[3], instances[2]));
+
+	return failed;
+}
+
+bool testSnapshots()
+{
+	bool failed = false;
+	parameterCombinations_t smallCombs;
+	smallCombs["a"] = ParametersVec::range(0, 4);
+	smallCombs["b"] = ParametersVec::range(0, 4);
+	parameterCombinations_t largeCombs = smallCombs;
+	largeCombs["c"] = ParametersVec::range(0, 8);
+	dontCares_t dontCares;
+
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(smallCombs, dontCares);
+
+	// A snapshot is not affected by later changes
+	auto snapshot = paramCombinator.getParameterInstanceSet();
+	paramCombinator.combine(largeCombs, dontCares);
+	failed |= !(snapshot->size() == 16 && paramCombinator.getParameterInstanceSet()->size() == 128);
+	paramCombinator.clearCombinations();
+	failed |= !(snapshot->size() == 16 && paramCombinator.getParameterInstanceSet()->empty());
+
+	// Readers iterate without locks while the results are regenerated
+	std::atomic<bool> done{ false };
+	std::atomic<bool> readerFailed{ false };
+	std::vector<std::thread> readers;
+	for (int reader = 0; reader < 4; ++reader)
+	{
+		readers.emplace_back([&]()
+		{
+			while (!done.load())
+			{
+				auto paramSet = paramCombinator.getParameterInstanceSet();
+				std::size_t size = 0;
+				for (auto& paramInstance : *paramSet)
+				{
+					size += paramInstance.count("a");
+				}
+				if (size != paramSet->size() || (size != 0 && size != 16 && size != 128))
+				{
+					readerFailed = true;
+				}
+			}
+		});
+	}
+	for (int round = 0; round < 50; ++round)
+	{
+		paramCombinator.combine(round % 2 ? largeCombs : smallCombs, dontCares);
+		if (round % 5 == 0)
+		{
+			paramCombinator.clearCombinations();
+		}
+	}
+	done = true;
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	failed |= readerFailed.load();
+
+	return failed;
+}
+
+bool testSuccessiveHalving()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 10);
+	paramCombs["b"] = ParametersVec::range(0, 10);
+	paramCombs["c"] = { 0, 1 };
+	dontCares_t dontCares;
+
+	std::size_t scorerCalls = 0;
+	auto scorer = [&](const parameterInstanceMap_t& paramInstance)
+	{
+		++scorerCalls;
+		int a = getVal<int>(paramInstance, "a");
+		int b = getVal<int>(paramInstance, "b");
+		return static_cast<double>((a - 3) * (a - 3) + (b - 7) * (b - 7) + getVal<int>(paramInstance, "c"));
+	};
+
+	HalvingOptions options;
+	options.roundBudget = 40;
+	options.seed = 1;
+	SuccessiveHalving halving(paramCombs, dontCares, options);
+	HalvingResult result = halving.run(scorer);
+
+	// Same optimum as the full sweep of 200 combinations with a fraction of the evaluations
+	failed |= !(getVal<int>(result.best, "a") == 3 && getVal<int>(result.best, "b") == 7 && getVal<int>(result.best, "c") == 0);
+	failed |= !(result.bestScore == 0.0);
+	failed |= !(result.evaluations == scorerCalls && result.evaluations < 100);
+	failed |= !(result.rounds.size() > 1 && result.rounds.front().combinations == 200);
+	failed |= !(result.survivors.at("a").size() == 1 && result.survivors.at("c").size() == 1);
+
+	// Maximizing
+	options.minimize = false;
+	result = SuccessiveHalving(paramCombs, dontCares, options).run([](const parameterInstanceMap_t& paramInstance)
+	{
+		return static_cast<double>(getVal<int>(paramInstance, "a") + getVal<int>(paramInstance, "b"));
+	});
+	failed |= !(result.bestScore == 18.0);
+
+	try
+	{
+		options.keepFraction = 1.0;
+		SuccessiveHalving invalid(paramCombs, dontCares, options);
+		failed = true;
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+
+	return failed;
+}
+
+bool testSweepJournal()
+{
+	bool failed = false;
+	// Ids are part of the file format and must not change
+	failed |= !(ParameterCombinator::combinationId({ {"a", 1} }) == 0xe6c4701904f456a8ull);
+
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 4);
+	paramCombs["b"] = { "x", "y", "z" };
+	dontCares_t dontCares;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+
+	const std::string path = (std::filesystem::temp_directory_path()
+		/ ("ParameterCombinatorTsJournal" + std::to_string(std::random_device{}()) + ".log")).string();
+	std::filesystem::remove(path);
+	auto evaluator = [](const parameterInstanceMap_t& paramInstance)
+	{
+		return ParameterCombinator::generateCombinationName(paramInstance);
+	};
+
+	// The sweep is killed after 5 combinations
+	{
+		SweepJournal journal(path);
+		std::size_t calls = 0;
+		try
+		{
+			journal.run(paramSet, [&](const parameterInstanceMap_t& paramInstance)
+			{
+				if (++calls > 5)
+				{
+					throw std::runtime_error("Killed");
+				}
+				return evaluator(paramInstance);
+			});
+			failed = true;
+		}
+		catch (const std::runtime_error&)
+		{
+		}
+	}
+
+	// A record torn in the middle of the write
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::app);
+		file.write("\x20\x00\x00\x00\x01\x02", 6);
+	}
+
+	{
+		SweepJournal journal(path);
+		failed |= !(journal.size() == 5 && journal.truncatedBytes() == 6);
+		failed |= !(journal.run(paramSet, evaluator) == 7);
+		for (auto& paramInstance : paramSet)
+		{
+			failed |= !(journal.isDone(paramInstance) && journal.result(paramInstance) == evaluator(paramInstance));
+		}
+	}
+
+	{
+		SweepJournal journal(path);
+		failed |= !(journal.size() == 12 && journal.truncatedBytes() == 0);
+		failed |= !(journal.run(paramSet, evaluator) == 0);
+	}
+	std::filesystem::remove(path);
+
+	return failed;
+}
+
+bool testGrayCodeOrder()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["model"]     = { "small", "large", "huge" };
+	paramCombs["dataset"]   = { "a", "b" };
+	paramCombs["single"]    = { 1 };
+	paramCombs["threshold"] = ParametersVec::range(0, 4);
+
+	// Without don't cares every step changes exactly one parameter
+	dontCares_t noDontCares;
+	std::set<std::string> visitedNames;
+	std::size_t steps = 0;
+	std::size_t count = SweepOrder::grayCode(paramCombs, noDontCares,
+		[&](const parameterInstanceMap_t& paramInstance, const std::vector<std::string>& changed)
+		{
+			failed |= !(changed.size() == (steps == 0 ? 4 : 1));
+			visitedNames.insert(ParameterCombinator::generateCombinationName(paramInstance));
+			++steps;
+		});
+	ParameterCombinator reference;
+	reference.combine(paramCombs, noDontCares);
+	failed |= !(count == 24 && steps == 24 && visitedNames == combinationNames(*reference.getParameterInstanceSet()));
+
+	// With don't cares the distinct combinations are visited once and the diffs match the instances
+	dontCares_t dontCares = { {"model", { {"huge", {"threshold"}} } } };
+	visitedNames.clear();
+	parameterInstanceMap_t previous;
+	count = SweepOrder::grayCode(paramCombs, dontCares,
+		[&](const parameterInstanceMap_t& paramInstance, const std::vector<std::string>& changed)
+		{
+			failed |= !visitedNames.insert(ParameterCombinator::generateCombinationName(paramInstance)).second;
+			failed |= !(changed == SweepOrder::changedParameters(previous, paramInstance) && !changed.empty());
+			previous = paramInstance;
+		});
+	reference.combine(paramCombs, dontCares);
+	failed |= !(count == 18 && visitedNames == combinationNames(*reference.getParameterInstanceSet()));
+
+	std::vector<std::string> expectedChanges{ "b", "c", "d" };
+	failed |= !(SweepOrder::changedParameters({ {"a", 1}, {"b", 2}, {"c", 3} }, { {"a", 1}, {"b", 3}, {"d", 3} }) == expectedChanges);
+
+	return failed;
+}
+
+bool testNestedSweep()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["dataset"]   = { "a", "b" };
+	paramCombs["model"]     = { "small", "large", "huge" };
+	paramCombs["threshold"] = ParametersVec::range(0, 4);
+
+	std::map<std::string, std::size_t> setupCalls;
+	std::map<std::string, Parameter> active;
+	parameterSetups_t setups;
+	for (auto& [name, cost] : std::map<std::string, double>{ {"dataset", 5.0}, {"model", 20.0} })
+	{
+		ParameterSetup& setup = setups[name];
+		setup.switchCost = cost;
+		setup.setup = [&](const std::string& param, const Parameter& value)
+		{
+			failed |= active.count(param) != 0;
+			active[param] = value;
+			++setupCalls[param];
+		};
+		setup.teardown = [&](const std::string& param, const Parameter& value)
+		{
+			failed |= !(active.count(param) && active.at(param) == value);
+			active.erase(param);
+		};
+	}
+
+	// The model is the most expensive to switch, so it becomes the outer loop and is loaded once per value
+	std::vector<std::string> expectedOrder{ "model", "dataset", "threshold" };
+	std::vector<std::string> order = SweepOrder::nestingOrder(paramCombs, setups);
+	failed |= !(order == expectedOrder);
+	std::vector<std::string> keyOrder{ "dataset", "model", "threshold" };
+	failed |= !(SweepOrder::nestingCost(paramCombs, setups, order) < SweepOrder::nestingCost(paramCombs, setups, keyOrder));
+
+	dontCares_t dontCares = { {"model", { {"huge", {"threshold"}} } } };
+	std::set<std::string> visitedNames;
+	std::size_t count = SweepOrder::nested(paramCombs, dontCares, setups, [&](const parameterInstanceMap_t& paramInstance)
+	{
+		// Hooks already ran for the values of this combination
+		failed |= !(active.at("model") == paramInstance.at("model") && active.at("dataset") == paramInstance.at("dataset"));
+		visitedNames.insert(ParameterCombinator::generateCombinationName(paramInstance));
+	});
+	ParameterCombinator reference;
+	reference.combine(paramCombs, dontCares);
+	failed |= !(count == 18 && visitedNames == combinationNames(*reference.getParameterInstanceSet()));
+	failed |= !(setupCalls["model"] == 3 && setupCalls["dataset"] == 6);
+	failed |= !active.empty();
+
+	return failed;
+}
+
+bool testProcessPool()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 10);
+	paramCombs["b"] = { "ok", "throws", "crashes" };
+	dontCares_t dontCares;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+
+	ProcessPoolOptions options;
+	options.workers = 3;
+	options.resultSize = 8;
+	ProcessPool pool(options);
+	ProcessPoolResult result = pool.run(paramSet, [](const parameterInstanceMap_t& paramInstance)
+	{
+		std::string behaviour = getVal<const char*>(paramInstance, "b");
+		if (behaviour == "throws")
+		{
+			throw std::runtime_error("Evaluation failed");
+		}
+		if (behaviour == "crashes" && getVal<int>(paramInstance, "a") % 5 == 0)
+		{
+			std::signal(SIGABRT, SIG_DFL);
+			std::abort();
+		}
+		return std::to_string(getVal<int>(paramInstance, "a")) + behaviour;
+	});
+
+	// Crashing combinations are recorded and the sweep carries on with new workers. A crash at the very end may
+	// leave nothing to respawn a worker for.
+	failed |= !(result.status.size() == 30 && result.crashes.size() == 2 && result.respawns >= 1 && result.respawns <= 2);
+	std::size_t index = 0;
+	for (auto& paramInstance : paramSet)
+	{
+		std::string behaviour = getVal<const char*>(paramInstance, "b");
+		int a = getVal<int>(paramInstance, "a");
+		if (behaviour == "throws")
+		{
+			// Results are truncated to the slot size
+			failed |= !(result.status[index] == EvaluationStatus::Failed && result.results[index] == "Evaluati");
+		}
+		else if (behaviour == "crashes" && a % 5 == 0)
+		{
+			failed |= !(result.status[index] == EvaluationStatus::Crashed);
+		}
+		else
+		{
+			failed |= !(result.status[index] == EvaluationStatus::Done && result.results[index] == std::to_string(a) + behaviour);
+		}
+		++index;
+	}
+	for (auto& crash : result.crashes)
+	{
+		failed |= !(crash.signal == SIGABRT && result.status[crash.index] == EvaluationStatus::Crashed);
+	}
+
+	return failed;
+}
+
+bool testBitmapIndex()
+{
+	bool failed = false;
+
+	// Containers switch between sorted arrays and bitmaps as they fill up
+	RoaringBitmap evens;
+	RoaringBitmap sparse;
+	for (std::uint32_t row = 0; row < 200000; row += 2)
+	{
+		evens.add(row);
+	}
+	for (std::uint32_t row = 0; row < 200000; row += 1000)
+	{
+		sparse.add(row);
+	}
+	RoaringBitmap block = RoaringBitmap::range(65000, 70000);
+	failed |= !(evens.cardinality() == 100000 && sparse.cardinality() == 200 && block.cardinality() == 5000);
+	failed |= !((evens & sparse) == sparse && (sparse - evens).empty());
+	failed |= !((evens | block).cardinality() == 102500 && (block - evens).cardinality() == 2500);
+	failed |= !(evens.contains(131072) && !evens.contains(131073) && block.toVector().front() == 65000);
+
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 100);
+	paramCombs["b"] = { "x", "y" };
+	paramCombs["c"] = { 1, 2, 3 };
+	dontCares_t dontCares;
+	dontCares["b"][Parameter("x")] = { "c" };
+	CombineOptions options;
+	options.buildIndex = true;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares, options);
+	auto index = paramCombinator.getParameterIndex();
+	failed |= !(index && index->rows() == 400 && index->absent("c") == index->equals("b", Parameter("x")));
+
+	// a in {5, 7} and b == y and c != 2
+	RoaringBitmap rows = index->anyOf("a", { 5, 7 }) & index->equals("b", Parameter("y"));
+	rows -= index->equals("c", 2);
+	std::set<std::string> expected;
+	for (auto& paramInstance : *paramCombinator.getParameterInstanceSet())
+	{
+		int a = getVal<int>(paramInstance, "a");
+		if ((a == 5 || a == 7) && std::string(getVal<const char*>(paramInstance, "b")) == "y" && getVal<int>(paramInstance, "c") != 2)
+		{
+			expected.insert(ParameterCombinator::generateCombinationName(paramInstance));
+		}
+	}
+	std::set<std::string> found;
+	for (auto* paramInstance : index->instances(rows))
+	{
+		found.insert(ParameterCombinator::generateCombinationName(*paramInstance));
+	}
+	failed |= !(found.size() == 4 && found == expected);
+	failed |= !(index->notEquals("c", 2).cardinality() == 200 && index->values("b").size() == 2);
+
+	// The index belongs to the result set it was built for
+	paramCombinator.combine(paramCombs, dontCares);
+	failed |= !(paramCombinator.getParameterIndex() == nullptr && index->instance(0).count("a") == 1);
+
+	return failed;
+}
+
+bool testExternalCombine()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 20);
+	paramCombs["b"] = { "x", "y" };
+	paramCombs["c"] = { 3, 1, 2, 1 };
+	dontCares_t dontCares;
+	dontCares["b"][Parameter("x")] = { "c" };
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	std::vector<std::string> expected;
+	for (auto& paramInstance : *paramCombinator.getParameterInstanceSet())
+	{
+		expected.push_back(ParameterCombinator::generateCombinationName(paramInstance));
+	}
+
+	// In memory, and with a budget of 8 rows so that 20 runs are spilled and merged in several passes
+	std::random_device random;
+	std::string tempDirectory = (std::filesystem::temp_directory_path() / ("externalCombineTs-" + std::to_string(random()))).string();
+	std::filesystem::create_directories(tempDirectory);
+	for (std::size_t memoryBudget : { std::size_t(1) << 20, std::size_t(8 * 16) })
+	{
+		ExternalCombineOptions options;
+		options.memoryBudget = memoryBudget;
+		options.tempDirectory = tempDirectory;
+		options.mergeFanIn = 2;
+		std::vector<std::string> names;
+		ExternalCombineStats stats = ExternalCombinator(paramCombs, dontCares, options).run([&](const parameterInstanceMap_t& paramInstance)
+		{
+			names.push_back(ParameterCombinator::generateCombinationName(paramInstance));
+		});
+		failed |= names != expected;
+		failed |= !(stats.rawCombinations == 160 && stats.distinctCombinations == expected.size());
+		failed |= memoryBudget < 1024 && !(stats.runs == 20 && stats.mergePasses == 5 && stats.spilledBytes > 0);
+	}
+	failed |= !std::filesystem::is_empty(tempDirectory);
+	std::filesystem::remove_all(tempDirectory);
+	return failed;
+}
+
+bool testExtract()
+{
+	bool failed = false;
+	// The spec can be passed as const or temporary objects
+	const parameterCombinations_t paramCombs = { { "a", ParametersVec::range(0, 10) }, { "b", { "x", "y" } } };
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares_t{});
+	const parameterInstanceMap_t* first = &*paramCombinator.getParameterInstanceSet()->begin();
+
+	// Nothing else holds the result set, so it is moved out without copying the combinations
+	parameterInstanceSet_t paramSet = paramCombinator.extract();
+	failed |= !(paramSet.size() == 20 && &*paramSet.begin() == first && paramCombinator.getParameterInstanceSet()->empty());
+
+	// A snapshot keeps seeing its result set, and Arena results are copied out of the arena
+	for (StorageMode storageMode : { StorageMode::Heap, StorageMode::Arena })
+	{
+		ParameterCombinator other(storageMode);
+		other.combine(paramCombs, dontCares_t{});
+		auto snapshot = other.getParameterInstanceSet();
+		parameterInstanceSet_t copied = other.extract();
+		failed |= !(copied.size() == 20 && snapshot->size() == 20 && &*copied.begin() != &*snapshot->begin());
+		failed |= !(copied == paramSet && other.getParameterInstanceSet()->empty());
+	}
+	return failed;
+}
+
+bool testMultiplicity()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = { 1, 2 };
+	paramCombs["b"] = { "x", "y", "z" };
+	paramCombs["c"] = { 1, 2, 3, 1 };
+	dontCares_t dontCares;
+	dontCares["b"][Parameter("x")] = { "c" };
+	dontCares["b"][Parameter("z")] = { "a", "c" };
+	// Chained rule: only fires while c is present
+	dontCares["c"][Parameter(3)] = { "a" };
+	CombineOptions options;
+	options.countMultiplicity = true;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares, options);
+
+	// Every raw combination is represented exactly once, duplicate values included
+	FanOut fanOut(paramCombs, dontCares);
+	std::uint64_t total = 0;
+	for (auto& paramInstance : *paramCombinator.getParameterInstanceSet())
+	{
+		std::uint64_t multiplicity = paramCombinator.multiplicity(paramInstance);
+		std::uint64_t expanded = fanOut.expand(paramInstance, [&](const parameterInstanceMap_t& rawInstance)
+		{
+			failed |= rawInstance.size() != 3;
+			for (auto& [name, value] : paramInstance)
+			{
+				failed |= rawInstance.at(name) != value;
+			}
+		});
+		failed |= !(multiplicity == expanded && fanOut.count(paramInstance) == multiplicity);
+		total += multiplicity;
+	}
+	failed |= total != 24;
+
+	parameterInstanceMap_t onlyB = { { "b", Parameter("z") } };
+	parameterInstanceMap_t yAndOne = { { "a", Parameter(2) }, { "b", Parameter("y") }, { "c", Parameter(1) } };
+	failed |= !(paramCombinator.multiplicity(onlyB) == 8 && fanOut.collapsedParameters(onlyB) == std::vector<std::string>{ "a", "c" });
+	failed |= !(paramCombinator.multiplicity(yAndOne) == 2 && fanOut.count({ { "d", Parameter(1) } }) == 0);
+
+	// Without the option nothing is recorded
+	paramCombinator.combine(paramCombs, dontCares);
+	bool thrown = false;
+	try
+	{
+		paramCombinator.multiplicity(onlyB);
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	failed |= !thrown;
+	return failed;
+}
+
+bool testTimingReport()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = { 1, 2, 3 };
+	paramCombs["b"] = { "x", "y" };
+	dontCares_t dontCares;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+
+	TimingOptions options;
+	options.repetitions = 3;
+	TimingExecutor executor(options);
+	std::size_t calls = 0;
+	TimingReport measured = executor.run(paramSet, [&](const parameterInstanceMap_t&) { ++calls; });
+	failed |= !(calls == 18 && measured.samples == 6 && measured.values.size() == 5 && measured.interactions.size() == 6);
+	failed |= measured.toJson().rfind("{\"samples\":6,", 0) != 0;
+
+	// Milliseconds: a costs its value, b=y one more, and a=3 with b=y another 6
+	std::vector<TimingExecutor::Sample> samples;
+	for (auto& paramInstance : paramSet)
+	{
+		int a = getVal<int>(paramInstance, "a");
+		bool y = std::string(getVal<const char*>(paramInstance, "b")) == "y";
+		double milliseconds = a + (y ? 1.0 : 0.0) + (a == 3 && y ? 6.0 : 0.0);
+		samples.push_back({ &paramInstance, milliseconds / 1000.0, 0.0 });
+	}
+	TimingReport report = executor.analyze(samples);
+	auto near = [](double lhs, double rhs) { return std::abs(lhs - rhs) < 1e-9; };
+	// Grand mean 3.5 ms. a=3 takes 3 and 10 ms, so its main effect is 3 ms.
+	failed |= !(near(report.grandMean, 0.0035) && report.parameters.front().parameter == "a");
+	const ValueTiming& a3 = report.values[2];
+	failed |= !(a3.parameter == "a" && a3.value == "3" && near(a3.mainEffect, 0.003) && near(a3.p99, 0.010) && near(a3.p50, 0.003));
+	// a=3 with b=y takes 10 ms against 6.5 ms for a=3 and 5 ms for b=y: 2 ms of interaction. a=3 with b=x mirrors it.
+	auto strongest = std::find_if(report.interactions.begin(), report.interactions.end(), [](const InteractionTiming& interaction)
+	{
+		return interaction.value1 == "3" && interaction.value2 == "y";
+	});
+	failed |= !(strongest - report.interactions.begin() < 2 && near(strongest->interaction, 0.002));
+	failed |= !near(std::abs(report.interactions[1].interaction), 0.002);
+	return failed;
+}
+
+bool testCoverageOrder()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 4);
+	paramCombs["b"] = ParametersVec::range(0, 4);
+	paramCombs["c"] = ParametersVec::range(0, 4);
+	dontCares_t dontCares;
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+	std::vector<const parameterInstanceMap_t*> order = SweepOrder::coverageOrder(paramSet);
+
+	// Covered values and value pairs of every prefix
+	auto coverage = [](const std::vector<const parameterInstanceMap_t*>& prefix, std::size_t length)
+	{
+		std::set<std::string> values;
+		std::set<std::string> pairs;
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			for (auto& [name, value] : *prefix[i])
+			{
+				values.insert(name + value->toString());
+				for (auto& [other, otherValue] : *prefix[i])
+				{
+					if (name < other)
+					{
+						pairs.insert(name + value->toString() + other + otherValue->toString());
+					}
+				}
+			}
+		}
+		return std::make_pair(values.size(), pairs.size());
+	};
+	std::set<const parameterInstanceMap_t*> distinct(order.begin(), order.end());
+	failed |= !(order.size() == 64 && distinct.size() == 64);
+	// 4 combinations reach all 12 values, where the set order only varies c. All 48 pairs come well before the end.
+	failed |= !(coverage(order, 4).first == 12 && coverage(order, 24).second == 48);
+	std::vector<const parameterInstanceMap_t*> setOrder;
+	for (auto& paramInstance : paramSet)
+	{
+		setOrder.push_back(&paramInstance);
+	}
+	failed |= !(coverage(setOrder, 4).first == 6 && coverage(setOrder, 13).second < coverage(order, 13).second);
+	return failed;
+}
+
+bool testSymmetries()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["channel-a-gain"] = { 1, 2, 3 };
+	paramCombs["channel-b-gain"] = { 1, 2, 3 };
+	paramCombs["mode"] = { "x", "y", "z" };
+	CombineOptions options;
+	CombineStats stats;
+	options.stats = &stats;
+	options.symmetries.interchangeable = { { "channel-b-gain", "channel-a-gain" } };
+	options.symmetries.collapsedValues["mode"] = { { Parameter("y"), Parameter("z") } };
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares_t{}, options);
+
+	// 6 unordered gain pairs times 2 modes, generated without filtering
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+	failed |= !(paramSet->size() == 12 && stats.rawCombinations == 12);
+	for (auto& paramInstance : *paramSet)
+	{
+		failed |= getVal<int>(paramInstance.at("channel-a-gain")) > getVal<int>(paramInstance.at("channel-b-gain"));
+		failed |= std::string(getVal<const char*>(paramInstance.at("mode"))) == "z";
+	}
+
+	// Every combination of the full product has its representative
+	ParameterCombinator fullCombinator;
+	fullCombinator.combine(paramCombs, dontCares_t{});
+	for (auto paramInstance : *fullCombinator.getParameterInstanceSet())
+	{
+		if (paramInstance.at("channel-b-gain") < paramInstance.at("channel-a-gain"))
+		{
+			std::swap(paramInstance.at("channel-a-gain"), paramInstance.at("channel-b-gain"));
+		}
+		if (std::string(getVal<const char*>(paramInstance.at("mode"))) == "z")
+		{
+			paramInstance.at("mode") = Parameter("y");
+		}
+		failed |= !paramSet->count(paramInstance);
+	}
+
+	auto throws = [&](const std::function<void()>& call)
+	{
+		try
+		{
+			call();
+		}
+		catch (const std::invalid_argument&)
+		{
+			return true;
+		}
+		return false;
+	};
+	CombineOptions mismatched;
+	mismatched.symmetries.interchangeable = { { "channel-a-gain", "mode" } };
+	failed |= !throws([&]() { paramCombinator.combine(paramCombs, dontCares_t{}, mismatched); });
+	// The error names the parameter whose values differ
+	mismatched.symmetries.interchangeable = { { "channel-b-gain", "mode", "channel-a-gain" } };
+	try
+	{
+		paramCombinator.combine(paramCombs, dontCares_t{}, mismatched);
+		failed = true;
+	}
+	catch (const std::invalid_argument& e)
+	{
+		failed |= std::string(e.what()) != "Interchangeable parameters channel-a-gain and mode have different values.";
+	}
+	CombineOptions unknown;
+	unknown.symmetries.interchangeable = { { "channel-a-gain", "channel-c-gain" } };
+	failed |= !throws([&]() { paramCombinator.combine(paramCombs, dontCares_t{}, unknown); });
+	ParameterSpace paramSpace;
+	paramSpace.parameters = paramCombs;
+	failed |= !throws([&]() { paramCombinator.combine(paramSpace, dontCares_t{}, options); });
+	return failed;
+}
+
+bool testValueDictionary()
+{
+	bool failed = false;
+	ValueDictionary dictionary(ParametersVec{ "ac", "ab", "ac", "b" });
+	failed |= !(dictionary.size() == 3 && dictionary.id(0) == dictionary.id(2));
+	failed |= !(dictionary.id(1) == 0 && dictionary.id(0) == 1 && dictionary.id(3) == 2);
+	// Interned values compare by rank among themselves and by value against anything else
+	failed |= !(dictionary[1] < dictionary[0] && dictionary[0] < dictionary[3] && dictionary[0] == dictionary[2]);
+	failed |= !(dictionary[0] == Parameter("ac") && Parameter("ab") < dictionary[0] && dictionary[0] != Parameter("b"));
+	failed |= !(&*dictionary[0] == &*dictionary[2] && dictionary[0]->dictionary() != 0 && Parameter("ac")->dictionary() == 0);
+	failed |= std::string(getVal<const char*>(dictionary.value(2))) != "b";
+
+	// The result set holds one shared copy of every value. Lazy values are not interned.
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = { 2, 1, 2 };
+	paramCombs["b"] = { 0, 1, 2 };
+	paramCombs["c"] = ParametersVec::range(0, 2);
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares_t{});
+	auto paramSet = paramCombinator.getParameterInstanceSet();
+	failed |= paramSet->size() != 12;
+	std::set<const ParameterBase*> bValues;
+	for (auto& paramInstance : *paramSet)
+	{
+		bValues.insert(&*paramInstance.at("b"));
+		failed |= paramInstance.at("a")->dictionary() == 0;
+		failed |= paramInstance.at("c")->dictionary() != 0;
+	}
+	failed |= bValues.size() != 3;
+	failed |= getVal<int>(paramSet->begin()->at("a")) != 1;
+	return failed;
+}
+
+bool testResultsStore()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 4);
+	paramCombs["b"] = { "x", "y", "z" };
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares_t{});
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+
+	const std::string path = (std::filesystem::temp_directory_path()
+		/ ("ParameterCombinatorTsResults" + std::to_string(std::random_device{}()) + ".log")).string();
+	std::filesystem::remove(path);
+	const std::vector<double> noise = { 1.0, 1.01, 0.99, 1.02, 0.98 };
+	{
+		ResultsStore store(path);
+		for (auto& paramInstance : paramSet)
+		{
+			// Every combination with b=z is 30 % slower in the second run
+			bool slower = std::string(getVal<const char*>(paramInstance.at("b"))) == "z";
+			std::vector<double> before;
+			std::vector<double> after;
+			for (double factor : noise)
+			{
+				before.push_back(factor * 0.001);
+				after.push_back(factor * (slower ? 0.0013 : 0.001));
+			}
+			store.record("nightly-1", paramInstance, before);
+			store.record("nightly-2", paramInstance, after);
+		}
+		store.record("nightly-1", *paramSet.begin(), { 0.001 });
+	}
+
+	// Reopening rebuilds the index from the log
+	ResultsStore store(path);
+	failed |= !(store.runs() == std::vector<std::string>{ "nightly-1", "nightly-2" } && store.combinations() == 12);
+	failed |= store.samples("nightly-1", *paramSet.begin()).size() != 6;
+	failed |= !(store.samples("nightly-3", *paramSet.begin()).empty() && store.samples("nightly-2", "c_1").empty());
+
+	RegressionReport report = store.compare("nightly-1", "nightly-2");
+	failed |= !(report.compared == 12 && report.combinations.size() == 4);
+	for (auto& regression : report.combinations)
+	{
+		failed |= regression.name.find("b_z") == std::string::npos;
+		failed |= !(std::abs(regression.slowdown - 0.3) < 0.01 && regression.pValue < 0.001);
+	}
+	failed |= report.values.size() != 1;
+	failed |= !report.values.empty() && !(report.values[0].parameter == "b" && report.values[0].value == "z" &&
+		report.values[0].combinations == 4);
+	// Nothing got slower the other way round
+	RegressionReport reverse = store.compare("nightly-2", "nightly-1");
+	failed |= !(reverse.combinations.empty() && reverse.values.empty());
+
+	bool thrown = false;
+	try
+	{
+		store.compare("nightly-1", "nightly-3");
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	failed |= !thrown;
+	std::filesystem::remove(path);
+	return failed;
+}
+
+bool testCompressedCombinations()
+{
+	bool failed = false;
+	parameterCombinations_t paramCombs;
+	paramCombs["a"] = ParametersVec::range(0, 6);
+	paramCombs["b"] = { "x", "y", "z" };
+	paramCombs["c"] = { 1.5, 2.5, 3.5, 4.5, 5.5 };
+	dontCares_t dontCares;
+	dontCares["b"][Parameter("z")] = { "c" };
+	ParameterCombinator paramCombinator;
+	paramCombinator.combine(paramCombs, dontCares);
+	const parameterInstanceSet_t& paramSet = *paramCombinator.getParameterInstanceSet();
+	std::vector<parameterInstanceMap_t> expected(paramSet.begin(), paramSet.end());
+
+	CompressedCombinations compressed(paramSet, 4);
+	failed |= !(compressed.size() == expected.size() && compressed.names() == std::vector<std::string>{ "a", "b", "c" });
+	std::size_t row = 0;
+	compressed.forEach([&](const parameterInstanceMap_t& paramInstance)
+	{
+		failed |= !(paramInstance == expected[row++]);
+	});
+	failed |= row != expected.size();
+	// Random access decodes from the start of the block
+	for (std::size_t i : { std::size_t(0), std::size_t(3), std::size_t(4), std::size_t(17), expected.size() - 1 })
+	{
+		failed |= !(compressed.at(i) == expected[i]);
+	}
+	std::vector<std::size_t> absentC;
+	compressed.forEachCodes([&](const CompressedCombinations::codes_t& codes)
+	{
+		if (!codes[2])
+		{
+			absentC.push_back(codes[0]);
+		}
+	}, 5, 30);
+	std::size_t expectedAbsent = std::count_if(expected.begin() + 5, expected.begin() + 30, [](const parameterInstanceMap_t& paramInstance)
+	{
+		return !paramInstance.count("c");
+	});
+	failed |= absentC.size() != expectedAbsent;
+	failed |= !(compressed.value(1, 2) == Parameter("y"));
+
+	// Streamed from the spec. A whole row takes 3 bits for a, 2 for b and 3 for c, but most rows only change c.
+	CompressedCombinations streamed(paramCombs);
+	ExternalCombinator(paramCombs, dontCares).run([&](const parameterInstanceMap_t& paramInstance)
+	{
+		streamed.append(paramInstance);
+	});
+	failed |= streamed.size() != expected.size();
+	row = 10;
+	streamed.forEach([&](const parameterInstanceMap_t& paramInstance)
+	{
+		failed |= !(paramInstance == expected[row++]);
+	}, 10);
+	failed |= row != expected.size();
+	failed |= streamed.bytes() > 2 * expected.size();
+
+	bool thrown = false;
+	try
+	{
+		streamed.append({ { "a", Parameter(7) } });
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	failed |= !(thrown && streamed.size() == expected.size());
+	return failed;
+}
+
 int main()
 {
 	testParameter();
@@ -615,9 +2090,32 @@ int main()
 	assert(!testCombinationWithDontCare());
 	assert(!testCombinationWithMultipleDontCares());
 	assert(!testSimpleRecombination());
-	//assert(!testAddition());
+	assert(!testAddition());
 	assert(!testGenerateCombinationName());
 	testIteration();
+	assert(!testLazyParametersVec());
+	assert(!testNestedParameterSpace());
+	assert(!testCombineStats());
+	assert(!testArenaStorage());
+	assert(!testBatchIteration());
+	assert(!testPipeline());
+	assert(!testCompiledDontCares());
+	assert(!testSnapshots());
+	assert(!testSuccessiveHalving());
+	assert(!testSweepJournal());
+	assert(!testGrayCodeOrder());
+	assert(!testNestedSweep());
+	assert(!testProcessPool());
+	assert(!testBitmapIndex());
+	assert(!testExternalCombine());
+	assert(!testExtract());
+	assert(!testMultiplicity());
+	assert(!testTimingReport());
+	assert(!testCoverageOrder());
+	assert(!testSymmetries());
+	assert(!testValueDictionary());
+	assert(!testResultsStore());
+	assert(!testCompressedCombinations());
 
 	return 0;
 }